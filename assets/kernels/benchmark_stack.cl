@@ -0,0 +1,4 @@
+#define BVH_TRAVERSAL BVH_TRAVERSAL_STACK
+#define RENDER_STATISTICS 1
+
+#include "path_tracing.cl"
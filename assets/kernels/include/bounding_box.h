@@ -1,9 +0,0 @@
-#ifndef BOUNDING_BOX_H_
-#define BOUNDING_BOX_H_
-
-typedef struct {
-    float3 minimum;
-    float3 maximum;
-} BoundingBox;
-
-#endif
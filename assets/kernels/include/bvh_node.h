@@ -1,14 +1,29 @@
 #ifndef BVH_NODE_H_
 #define BVH_NODE_H_
 
-#include "include/bounding_box.h"
+#define BVH_INVALID_INDEX 0xFFFFFFFFu
+#define BVH_CHILD_TRIANGLE_COUNT_BITS 16u
+#define BVH_CHILD_TRIANGLE_COUNT_MASK 0xFFFFu
 
 typedef struct {
-    BoundingBox bounds;
-    uint firstTriangleOffset;
-    uint triangleCount;
-    uint splitAxis;
-    uint padding;
+    float4 leftBoundsXY;
+    float4 rightBoundsXY;
+    float4 childrenBoundsZ;
+    uint leftIndex;
+    uint rightIndex;
+    uint childrenTriangleCounts;
+    uint parentIndex;
 } BVHNode;
 
+typedef struct {
+    uint nearIndex;
+    uint farIndex;
+    uint nearTriangleCount;
+    uint farTriangleCount;
+    float nearEntry;
+    float farEntry;
+    bool isNearHit;
+    bool isFarHit;
+} BVHChildren;
+
 #endif
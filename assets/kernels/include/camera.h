@@ -0,0 +1,44 @@
+#ifndef CAMERA_H_
+#define CAMERA_H_
+
+#include "include/ray.h"
+
+typedef struct {
+    float3 position;
+    float3 forward;
+    float3 right;
+    float3 up;
+    float fov;
+    float aspectRatio;
+    float width;
+    float height;
+} Camera;
+
+Ray generate_camera_ray(const Camera *camera, const float2 pixel) {
+    const float pixelScreenX = (2.0f * (pixel.x / camera->width) - 1.0f) * camera->aspectRatio * camera->fov;
+    const float pixelScreenY = (2.0f * (pixel.y / camera->height) - 1.0f) * camera->fov;
+
+    Ray ray;
+    ray.origin = camera->position;
+    ray.direction = normalize(pixelScreenX * camera->right + pixelScreenY * camera->up + camera->forward);
+    return ray;
+}
+
+bool project_to_camera(const Camera *camera, const float3 position, int2 *pixel, float *distance) {
+    const float3 offset = position - camera->position;
+    const float z = dot(offset, camera->forward);
+    if (z <= FLT_EPSILON) {
+        return false;
+    }
+
+    const float pixelScreenX = dot(offset, camera->right) / (z * camera->aspectRatio * camera->fov);
+    const float pixelScreenY = dot(offset, camera->up) / (z * camera->fov);
+    const float2 projectedPixel = (float2)((pixelScreenX + 1.0f) * 0.5f * camera->width, (pixelScreenY + 1.0f) * 0.5f * camera->height);
+
+    *pixel = convert_int2(floor(projectedPixel + 0.5f));
+    *distance = length(offset);
+
+    return (pixel->x >= 0) && (pixel->y >= 0) && (pixel->x < (int)(camera->width)) && (pixel->y < (int)(camera->height));
+}
+
+#endif
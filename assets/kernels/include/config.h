@@ -0,0 +1,23 @@
+#ifndef CONFIG_H_
+#define CONFIG_H_
+
+#define SAMPLER_PRNG 0
+#define SAMPLER_SOBOL 1
+#define SAMPLER_RANK1 2
+
+#ifndef SAMPLER
+#define SAMPLER SAMPLER_SOBOL
+#endif
+
+#define BVH_TRAVERSAL_STACK 0
+#define BVH_TRAVERSAL_STACKLESS 1
+
+#ifndef BVH_TRAVERSAL
+#define BVH_TRAVERSAL BVH_TRAVERSAL_STACK
+#endif
+
+#ifndef RENDER_STATISTICS
+#define RENDER_STATISTICS 0
+#endif
+
+#endif
@@ -0,0 +1,36 @@
+#ifndef DENOISE_H_
+#define DENOISE_H_
+
+#define DENOISE_ALBEDO_EPSILON 1e-3f
+
+__constant float ATROUS_KERNEL[3] = {3.0f / 8.0f, 1.0f / 4.0f, 1.0f / 16.0f};
+
+float atrous_kernel_weight(const int dx, const int dy) {
+    return ATROUS_KERNEL[abs(dx)] * ATROUS_KERNEL[abs(dy)];
+}
+
+float3 demodulate_albedo(const float3 color, const float3 albedo) {
+    return color / max(albedo, DENOISE_ALBEDO_EPSILON);
+}
+
+float3 remodulate_albedo(const float3 color, const float3 albedo) {
+    return color * max(albedo, DENOISE_ALBEDO_EPSILON);
+}
+
+float edge_stopping_weight(const float3 centerColor, const float3 neighbourColor,
+                           const float3 centerNormal, const float3 neighbourNormal,
+                           const float centerDepth, const float neighbourDepth,
+                           const float colorPhi, const float normalPhi, const float depthPhi) {
+    const float3 colorDifference = centerColor - neighbourColor;
+    const float colorWeight = exp(-dot(colorDifference, colorDifference) / max(colorPhi, FLT_EPSILON));
+    const float normalWeight = pow(max(dot(centerNormal, neighbourNormal), 0.0f), normalPhi);
+    const float depthWeight = exp(-fabs(centerDepth - neighbourDepth) / max(depthPhi, FLT_EPSILON));
+
+    return colorWeight * normalWeight * depthWeight;
+}
+
+float3 feature_normal(const float4 normalDepth) {
+    return normalize(normalDepth.xyz + FLT_EPSILON);
+}
+
+#endif
@@ -3,9 +3,12 @@
 
 typedef struct {
     float tNearest;
+    float tDeferred;
     float u, v;
     uint triangleIndex;
+    uint instanceIndex;
     bool isHit;
+    bool isDeferred;
 } Hit;
 
 #endif
@@ -0,0 +1,31 @@
+#ifndef INSTANCE_H_
+#define INSTANCE_H_
+
+typedef struct {
+    uint nodeOffset;
+    uint triangleOffset;
+    uint isResident;
+    uint padding;
+} Mesh;
+
+typedef struct {
+    float4 objectToWorld[3];
+    float4 worldToObject[3];
+    uint meshIndex;
+    uint padding[3];
+} Instance;
+
+float3 transform_point(const float4 *matrix, const float3 point) {
+    const float4 p = (float4)(point, 1.0f);
+    return (float3)(dot(matrix[0], p), dot(matrix[1], p), dot(matrix[2], p));
+}
+
+float3 transform_vector(const float4 *matrix, const float3 vector) {
+    return (float3)(dot(matrix[0].xyz, vector), dot(matrix[1].xyz, vector), dot(matrix[2].xyz, vector));
+}
+
+float3 transform_normal(const float4 *inverseMatrix, const float3 normal) {
+    return normalize(normal.x * inverseMatrix[0].xyz + normal.y * inverseMatrix[1].xyz + normal.z * inverseMatrix[2].xyz);
+}
+
+#endif
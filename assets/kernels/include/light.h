@@ -1,15 +1,26 @@
 #ifndef LIGHT_H_
 #define LIGHT_H_
 
+#define LIGHT_TYPE_RECTANGLE 0u
+#define LIGHT_TYPE_TRIANGLE 1u
+
 typedef struct {
     float3 position;
     float3 emission;
     float3 u;
     float3 v;
     float area;
-    uint padding[3];
+    uint type;
+    uint padding[2];
 } Light;
 
+typedef struct {
+    float probability;
+    float pmf;
+    uint alias;
+    uint padding;
+} LightAliasEntry;
+
 typedef struct {
     float3 normal;
     float3 emission;
@@ -18,9 +29,19 @@ typedef struct {
     float pdf;
 } LightSample;
 
-LightSample sample_rectangle_light(const Light *light, const float3 intersectionPoint, const float2 random) {
-    const float3 lightSurfacePosition = light->position + light->u * random.x + light->v * random.y;
+uint sample_light_alias_table(const LightAliasEntry *aliasTable, const uint lightsCount, const float random, float *pmf) {
+    const float scaledRandom = random * (float)lightsCount;
+    uint index = min((uint)scaledRandom, lightsCount - 1u);
 
+    if (scaledRandom - (float)index >= aliasTable[index].probability) {
+        index = aliasTable[index].alias;
+    }
+
+    *pmf = aliasTable[index].pmf;
+    return index;
+}
+
+LightSample sample_light_surface(const Light *light, const float3 lightSurfacePosition, const float3 intersectionPoint) {
     LightSample result;
     result.normal = normalize(cross(light->u, light->v));
     result.emission = light->emission;
@@ -34,4 +55,23 @@ LightSample sample_rectangle_light(const Light *light, const float3 intersection
     return result;
 }
 
+LightSample sample_rectangle_light(const Light *light, const float3 intersectionPoint, const float2 random) {
+    const float3 lightSurfacePosition = light->position + light->u * random.x + light->v * random.y;
+    return sample_light_surface(light, lightSurfacePosition, intersectionPoint);
+}
+
+LightSample sample_triangle_light(const Light *light, const float3 intersectionPoint, const float2 random) {
+    const float su = sqrt(random.x);
+    const float3 lightSurfacePosition = light->position + light->u * (su * (1.0f - random.y)) + light->v * (su * random.y);
+    return sample_light_surface(light, lightSurfacePosition, intersectionPoint);
+}
+
+LightSample sample_light(const Light *light, const float3 intersectionPoint, const float2 random) {
+    if (light->type == LIGHT_TYPE_TRIANGLE) {
+        return sample_triangle_light(light, intersectionPoint, random);
+    }
+
+    return sample_rectangle_light(light, intersectionPoint, random);
+}
+
 #endif
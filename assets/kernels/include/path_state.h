@@ -0,0 +1,33 @@
+#ifndef PATH_STATE_H_
+#define PATH_STATE_H_
+
+#include "include/ray.h"
+
+typedef struct {
+    float4 origin;
+    float4 direction;
+    float4 throughput;
+    float4 radiance;
+    float4 albedo;
+    float4 normalDepth;
+    uint2 seed;
+    uint sampleIndex;
+    uint bounce;
+    uint isActive;
+    uint padding[3];
+} PathState;
+
+void store_path_state(PathState *state, const Ray *ray, const float3 throughput, const float3 radiance, const float4 albedo, const float4 normalDepth, const uint2 seed, const uint sampleIndex, const uint bounce) {
+    state->origin = (float4)(ray->origin, 0.0f);
+    state->direction = (float4)(ray->direction, 0.0f);
+    state->throughput = (float4)(throughput, 0.0f);
+    state->radiance = (float4)(radiance, 0.0f);
+    state->albedo = albedo;
+    state->normalDepth = normalDepth;
+    state->seed = seed;
+    state->sampleIndex = sampleIndex;
+    state->bounce = bounce;
+    state->isActive = 1u;
+}
+
+#endif
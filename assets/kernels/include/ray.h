@@ -2,11 +2,16 @@
 #define RAY_H_
 
 #include "include/bvh_node.h"
+#include "include/config.h"
 #include "include/hit.h"
+#include "include/instance.h"
 #include "include/light.h"
 #include "include/plane.h"
 #include "include/triangle.h"
 
+#define TRAVERSAL_STATE_NEAR_CHILD 0u
+#define TRAVERSAL_STATE_FAR_CHILD 1u
+
 typedef struct {
     float3 origin;
     float3 direction;
@@ -73,16 +78,6 @@ bool intersect_ray_plane(const float3 origin, const float3 direction, const Plan
     return false;
 }
 
-bool intersect_ray_bounding_box(const float3 origin, const float3 direction, const float tNearest, const BoundingBox *bounds) {
-    float3 t0 = (float3)((bounds->minimum.x - origin.x) / direction.x, (bounds->minimum.y - origin.y) / direction.y, (bounds->minimum.z - origin.z) / direction.z);
-    float3 t1 = (float3)((bounds->maximum.x - origin.x) / direction.x, (bounds->maximum.y - origin.y) / direction.y, (bounds->maximum.z - origin.z) / direction.z);
-
-    float tMin = max(max(min(t0.x, t1.x), min(t0.y, t1.y)), min(t0.z, t1.z));
-    float tMax = min(min(max(t0.x, t1.x), max(t0.y, t1.y)), max(t0.z, t1.z));
-
-    return (tMax >= tMin) && (tMin < tNearest) && (tMax > 0.0f);
-}
-
 bool intersect_ray_light(const Ray *ray, const Light *light, const Hit *hit) {
     Hit lightHit;
     lightHit.tNearest = hit->tNearest;
@@ -106,43 +101,292 @@ bool intersect_ray_light(const Ray *ray, const Light *light, const Hit *hit) {
     return false;
 }
 
-Hit intersect_ray_bvh(const Ray *ray, const BVHNode *nodes, const Triangle *triangles) {
+float2 intersect_ray_child_bounds(const float3 origin, const float3 invertedDirection, const float4 boundsXY, const float2 boundsZ) {
+    const float2 tX = (boundsXY.xy - origin.x) * invertedDirection.x;
+    const float2 tY = (boundsXY.zw - origin.y) * invertedDirection.y;
+    const float2 tZ = (boundsZ - origin.z) * invertedDirection.z;
+
+    const float tEntry = max(max(min(tX.x, tX.y), min(tY.x, tY.y)), min(tZ.x, tZ.y));
+    const float tExit = min(min(max(tX.x, tX.y), max(tY.x, tY.y)), max(tZ.x, tZ.y));
+    return (float2)(tEntry, tExit);
+}
+
+BVHChildren intersect_ray_bvh_children(const float3 origin, const float3 invertedDirection, const float tNearest, const BVHNode *node) {
+    const float2 left = intersect_ray_child_bounds(origin, invertedDirection, node->leftBoundsXY, node->childrenBoundsZ.xy);
+    const float2 right = intersect_ray_child_bounds(origin, invertedDirection, node->rightBoundsXY, node->childrenBoundsZ.zw);
+    const bool hasRightChild = node->rightIndex != BVH_INVALID_INDEX;
+    const bool isLeftHit = (left.y >= left.x) && (left.x < tNearest) && (left.y > 0.0f);
+    const bool isRightHit = hasRightChild && (right.y >= right.x) && (right.x < tNearest) && (right.y > 0.0f);
+    const bool isRightNear = hasRightChild && (right.x < left.x);
+
+    const uint leftTriangleCount = node->childrenTriangleCounts & BVH_CHILD_TRIANGLE_COUNT_MASK;
+    const uint rightTriangleCount = node->childrenTriangleCounts >> BVH_CHILD_TRIANGLE_COUNT_BITS;
+
+    BVHChildren children;
+    children.nearIndex = isRightNear ? node->rightIndex : node->leftIndex;
+    children.farIndex = isRightNear ? node->leftIndex : node->rightIndex;
+    children.nearTriangleCount = isRightNear ? rightTriangleCount : leftTriangleCount;
+    children.farTriangleCount = isRightNear ? leftTriangleCount : rightTriangleCount;
+    children.nearEntry = isRightNear ? right.x : left.x;
+    children.farEntry = isRightNear ? left.x : right.x;
+    children.isNearHit = isRightNear ? isRightHit : isLeftHit;
+    children.isFarHit = isRightNear ? isLeftHit : isRightHit;
+    return children;
+}
+
+void intersect_ray_triangles(const Ray *ray, const Triangle *triangles, const uint firstTriangleIndex, const uint triangleCount, const uint instanceIndex, Hit *hit) {
+    for (uint i = 0u; i < triangleCount; i++) {
+        const uint triangleIndex = firstTriangleIndex + i;
+        if (intersect_ray_triangle(ray->origin, ray->direction, &triangles[triangleIndex], hit)) {
+            hit->triangleIndex = triangleIndex;
+            hit->instanceIndex = instanceIndex;
+            hit->isHit = true;
+        }
+    }
+}
+
+Ray transform_ray_to_instance(const Ray *worldRay, const Instance *instance) {
+    Ray ray;
+    ray.origin = transform_point(instance->worldToObject, worldRay->origin);
+    ray.direction = transform_vector(instance->worldToObject, worldRay->direction);
+    return ray;
+}
+
+Hit create_hit() {
     Hit hit;
     hit.tNearest = FLT_MAX;
+    hit.tDeferred = FLT_MAX;
     hit.isHit = false;
+    hit.isDeferred = false;
+    return hit;
+}
+
+void defer_hit(Hit *hit, const float tEntry) {
+    hit->tDeferred = min(hit->tDeferred, max(tEntry, 0.0f));
+}
+
+void resolve_deferred_hit(Hit *hit) {
+    hit->isDeferred = hit->tDeferred < hit->tNearest;
+}
+
+bool request_mesh(const Mesh *meshes, uint *meshRequests, const uint meshIndex) {
+    if (meshRequests[meshIndex] == 0u) {
+        meshRequests[meshIndex] = 1u;
+    }
+
+    return meshes[meshIndex].isResident != 0u;
+}
+
+#if BVH_TRAVERSAL == BVH_TRAVERSAL_STACKLESS
+bool bvh_ascend(const BVHNode *nodes, const float3 origin, const float3 invertedDirection, uint *nodeIndex) {
+    while (*nodeIndex != 0u) {
+        const uint parentIndex = nodes[*nodeIndex].parentIndex;
+        const BVHChildren children = intersect_ray_bvh_children(origin, invertedDirection, FLT_MAX, &nodes[parentIndex]);
+        const bool isNearChild = (children.nearTriangleCount == 0u) && (children.nearIndex == *nodeIndex);
+
+        *nodeIndex = parentIndex;
+        if (isNearChild) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void intersect_mesh(const Ray *ray,
+                    const BVHNode *nodes,
+                    const Triangle *triangles,
+                    const uint triangleOffset,
+                    const uint instanceIndex,
+                    Hit *hit) {
+    const float3 invertedDirection = 1.0f / ray->direction;
 
     uint currentNodeIndex = 0u;
-    uint nodesToVisit[64];
-    uint offsetToVisit = 0u;
-    float3 invertedDirection = 1.0f / ray->direction;
-    bool isDirectionNegative[3] = {invertedDirection.x < 0.0f, invertedDirection.y < 0.0f, invertedDirection.z < 0.0f};
+    uint state = TRAVERSAL_STATE_NEAR_CHILD;
+    while (true) {
+        const BVHChildren children = intersect_ray_bvh_children(ray->origin, invertedDirection, hit->tNearest, &nodes[currentNodeIndex]);
+        const bool isNearChild = state == TRAVERSAL_STATE_NEAR_CHILD;
+        const bool isChildHit = isNearChild ? children.isNearHit : children.isFarHit;
+        const uint childIndex = isNearChild ? children.nearIndex : children.farIndex;
+        const uint childTriangleCount = isNearChild ? children.nearTriangleCount : children.farTriangleCount;
+
+        if (isChildHit) {
+            if (childTriangleCount == 0u) {
+                currentNodeIndex = childIndex;
+                state = TRAVERSAL_STATE_NEAR_CHILD;
+                continue;
+            }
+
+            intersect_ray_triangles(ray, triangles, triangleOffset + childIndex, childTriangleCount, instanceIndex, hit);
+        }
+
+        if (isNearChild) {
+            state = TRAVERSAL_STATE_FAR_CHILD;
+            continue;
+        }
+
+        if (!bvh_ascend(nodes, ray->origin, invertedDirection, &currentNodeIndex)) {
+            break;
+        }
+        state = TRAVERSAL_STATE_FAR_CHILD;
+    }
+}
+
+Hit intersect_scene(const Ray *worldRay,
+                    const BVHNode *topLevelNodes,
+                    const Instance *instances,
+                    const Mesh *meshes,
+                    const BVHNode *bottomLevelNodes,
+                    const Triangle *triangles,
+                    uint *meshRequests) {
+    Hit hit = create_hit();
 
+    const float3 invertedDirection = 1.0f / worldRay->direction;
+
+    uint currentNodeIndex = 0u;
+    uint state = TRAVERSAL_STATE_NEAR_CHILD;
     while (true) {
-        const BVHNode *currentNode = &nodes[currentNodeIndex];
-
-        if (intersect_ray_bounding_box(ray->origin, ray->direction, hit.tNearest, &currentNode->bounds)) {
-            if (currentNode->triangleCount > 0u) {
-                for (uint i = 0u; i < currentNode->triangleCount; i++) {
-                    if (intersect_ray_triangle(ray->origin, ray->direction, &triangles[currentNode->firstTriangleOffset + i], &hit)) {
-                        hit.triangleIndex = currentNode->firstTriangleOffset + i;
-                        hit.isHit = true;
-                    }
-                }
+        const BVHChildren children = intersect_ray_bvh_children(worldRay->origin, invertedDirection, hit.tNearest, &topLevelNodes[currentNodeIndex]);
+        const bool isNearChild = state == TRAVERSAL_STATE_NEAR_CHILD;
+        const bool isChildHit = isNearChild ? children.isNearHit : children.isFarHit;
+        const uint childIndex = isNearChild ? children.nearIndex : children.farIndex;
+        const uint childTriangleCount = isNearChild ? children.nearTriangleCount : children.farTriangleCount;
+        const float childEntry = isNearChild ? children.nearEntry : children.farEntry;
 
-                if (offsetToVisit == 0u) {
-                    break;
-                }
+        if (isChildHit) {
+            if (childTriangleCount == 0u) {
+                currentNodeIndex = childIndex;
+                state = TRAVERSAL_STATE_NEAR_CHILD;
+                continue;
+            }
 
-                currentNodeIndex = nodesToVisit[--offsetToVisit];
-            } else {
-                if (isDirectionNegative[currentNode->splitAxis]) {
-                    nodesToVisit[offsetToVisit++] = currentNodeIndex + 1;
-                    currentNodeIndex = currentNode->firstTriangleOffset;
-                } else {
-                    nodesToVisit[offsetToVisit++] = currentNode->firstTriangleOffset;
-                    currentNodeIndex++;
+            for (uint i = 0u; i < childTriangleCount; i++) {
+                const uint instanceIndex = childIndex + i;
+                const uint meshIndex = instances[instanceIndex].meshIndex;
+                if (!request_mesh(meshes, meshRequests, meshIndex)) {
+                    defer_hit(&hit, childEntry);
+                    continue;
                 }
+
+                const Mesh *mesh = &meshes[meshIndex];
+                const Ray ray = transform_ray_to_instance(worldRay, &instances[instanceIndex]);
+                intersect_mesh(&ray, &bottomLevelNodes[mesh->nodeOffset], triangles, mesh->triangleOffset, instanceIndex, &hit);
             }
+        }
+
+        if (isNearChild) {
+            state = TRAVERSAL_STATE_FAR_CHILD;
+            continue;
+        }
+
+        if (!bvh_ascend(topLevelNodes, worldRay->origin, invertedDirection, &currentNodeIndex)) {
+            break;
+        }
+        state = TRAVERSAL_STATE_FAR_CHILD;
+    }
+
+    resolve_deferred_hit(&hit);
+    return hit;
+}
+#else
+void intersect_mesh(const Ray *ray,
+                    const BVHNode *nodes,
+                    const Triangle *triangles,
+                    const uint triangleOffset,
+                    const uint instanceIndex,
+                    uint *nodesToVisit,
+                    const uint stackOffset,
+                    Hit *hit) {
+    const float3 invertedDirection = 1.0f / ray->direction;
+
+    uint currentNodeIndex = 0u;
+    uint offsetToVisit = stackOffset;
+    while (true) {
+        const BVHChildren children = intersect_ray_bvh_children(ray->origin, invertedDirection, hit->tNearest, &nodes[currentNodeIndex]);
+        if (children.isNearHit && children.nearTriangleCount > 0u) {
+            intersect_ray_triangles(ray, triangles, triangleOffset + children.nearIndex, children.nearTriangleCount, instanceIndex, hit);
+        }
+        if (children.isFarHit && children.farTriangleCount > 0u) {
+            intersect_ray_triangles(ray, triangles, triangleOffset + children.farIndex, children.farTriangleCount, instanceIndex, hit);
+        }
+
+        const bool isNearTraversed = children.isNearHit && (children.nearTriangleCount == 0u);
+        const bool isFarTraversed = children.isFarHit && (children.farTriangleCount == 0u);
+        if (isNearTraversed) {
+            if (isFarTraversed) {
+                nodesToVisit[offsetToVisit++] = children.farIndex;
+            }
+            currentNodeIndex = children.nearIndex;
+        } else if (isFarTraversed) {
+            currentNodeIndex = children.farIndex;
+        } else {
+            if (offsetToVisit == stackOffset) {
+                break;
+            }
+
+            currentNodeIndex = nodesToVisit[--offsetToVisit];
+        }
+    }
+}
+
+void intersect_instances(const Ray *worldRay,
+                         const Instance *instances,
+                         const Mesh *meshes,
+                         const BVHNode *bottomLevelNodes,
+                         const Triangle *triangles,
+                         uint *meshRequests,
+                         const uint firstInstanceIndex,
+                         const uint instanceCount,
+                         const float tEntry,
+                         uint *nodesToVisit,
+                         const uint stackOffset,
+                         Hit *hit) {
+    for (uint i = 0u; i < instanceCount; i++) {
+        const uint instanceIndex = firstInstanceIndex + i;
+        const uint meshIndex = instances[instanceIndex].meshIndex;
+        if (!request_mesh(meshes, meshRequests, meshIndex)) {
+            defer_hit(hit, tEntry);
+            continue;
+        }
+
+        const Mesh *mesh = &meshes[meshIndex];
+        const Ray ray = transform_ray_to_instance(worldRay, &instances[instanceIndex]);
+        intersect_mesh(&ray, &bottomLevelNodes[mesh->nodeOffset], triangles, mesh->triangleOffset, instanceIndex, nodesToVisit, stackOffset, hit);
+    }
+}
+
+Hit intersect_scene(const Ray *worldRay,
+                    const BVHNode *topLevelNodes,
+                    const Instance *instances,
+                    const Mesh *meshes,
+                    const BVHNode *bottomLevelNodes,
+                    const Triangle *triangles,
+                    uint *meshRequests) {
+    Hit hit = create_hit();
+
+    const float3 invertedDirection = 1.0f / worldRay->direction;
+
+    uint currentNodeIndex = 0u;
+    uint nodesToVisit[64];
+    uint offsetToVisit = 0u;
+    while (true) {
+        const BVHChildren children = intersect_ray_bvh_children(worldRay->origin, invertedDirection, hit.tNearest, &topLevelNodes[currentNodeIndex]);
+        if (children.isNearHit && children.nearTriangleCount > 0u) {
+            intersect_instances(worldRay, instances, meshes, bottomLevelNodes, triangles, meshRequests, children.nearIndex, children.nearTriangleCount, children.nearEntry, nodesToVisit, offsetToVisit, &hit);
+        }
+        if (children.isFarHit && children.farTriangleCount > 0u) {
+            intersect_instances(worldRay, instances, meshes, bottomLevelNodes, triangles, meshRequests, children.farIndex, children.farTriangleCount, children.farEntry, nodesToVisit, offsetToVisit, &hit);
+        }
+
+        const bool isNearTraversed = children.isNearHit && (children.nearTriangleCount == 0u);
+        const bool isFarTraversed = children.isFarHit && (children.farTriangleCount == 0u);
+        if (isNearTraversed) {
+            if (isFarTraversed) {
+                nodesToVisit[offsetToVisit++] = children.farIndex;
+            }
+            currentNodeIndex = children.nearIndex;
+        } else if (isFarTraversed) {
+            currentNodeIndex = children.farIndex;
         } else {
             if (offsetToVisit == 0u) {
                 break;
@@ -152,7 +396,9 @@ Hit intersect_ray_bvh(const Ray *ray, const BVHNode *nodes, const Triangle *tria
         }
     }
 
+    resolve_deferred_hit(&hit);
     return hit;
 }
+#endif
 
 #endif
@@ -0,0 +1,134 @@
+#ifndef SAMPLER_H_
+#define SAMPLER_H_
+
+#include "include/config.h"
+#include "include/utilities.h"
+
+#define SAMPLER_CAMERA_DIMENSIONS 2u
+#define SAMPLER_BOUNCE_DIMENSIONS 8u
+#define SAMPLER_FLOAT_CONSTANT 5.96046448e-8f
+
+#define RANK1_GENERATOR_X 3242174889u
+#define RANK1_GENERATOR_Y 2447445413u
+
+__constant uint SOBOL_DIRECTIONS[4][32] = {
+    {0x80000000u, 0x40000000u, 0x20000000u, 0x10000000u, 0x08000000u, 0x04000000u, 0x02000000u, 0x01000000u, 0x00800000u, 0x00400000u, 0x00200000u, 0x00100000u, 0x00080000u, 0x00040000u, 0x00020000u, 0x00010000u, 0x00008000u, 0x00004000u, 0x00002000u, 0x00001000u, 0x00000800u, 0x00000400u, 0x00000200u, 0x00000100u, 0x00000080u, 0x00000040u, 0x00000020u, 0x00000010u, 0x00000008u, 0x00000004u, 0x00000002u, 0x00000001u},
+    {0x80000000u, 0xc0000000u, 0xa0000000u, 0xf0000000u, 0x88000000u, 0xcc000000u, 0xaa000000u, 0xff000000u, 0x80800000u, 0xc0c00000u, 0xa0a00000u, 0xf0f00000u, 0x88880000u, 0xcccc0000u, 0xaaaa0000u, 0xffff0000u, 0x80008000u, 0xc000c000u, 0xa000a000u, 0xf000f000u, 0x88008800u, 0xcc00cc00u, 0xaa00aa00u, 0xff00ff00u, 0x80808080u, 0xc0c0c0c0u, 0xa0a0a0a0u, 0xf0f0f0f0u, 0x88888888u, 0xccccccccu, 0xaaaaaaaau, 0xffffffffu},
+    {0x80000000u, 0xc0000000u, 0x60000000u, 0x90000000u, 0xe8000000u, 0x5c000000u, 0x8e000000u, 0xc5000000u, 0x68800000u, 0x9cc00000u, 0xee600000u, 0x55900000u, 0x80680000u, 0xc09c0000u, 0x60ee0000u, 0x90550000u, 0xe8808000u, 0x5cc0c000u, 0x8e606000u, 0xc5909000u, 0x6868e800u, 0x9c9c5c00u, 0xeeee8e00u, 0x5555c500u, 0x8000e880u, 0xc0005cc0u, 0x60008e60u, 0x9000c590u, 0xe8006868u, 0x5c009c9cu, 0x8e00eeeeu, 0xc5005555u},
+    {0x80000000u, 0xc0000000u, 0x20000000u, 0x50000000u, 0xf8000000u, 0x74000000u, 0xa2000000u, 0x93000000u, 0xd8800000u, 0x25400000u, 0x59e00000u, 0xe6d00000u, 0x78080000u, 0xb40c0000u, 0x82020000u, 0xc3050000u, 0x208f8000u, 0x51474000u, 0xfbea2000u, 0x75d93000u, 0xa0858800u, 0x914e5400u, 0xdbe79e00u, 0x25db6d00u, 0x58800080u, 0xe54000c0u, 0x79e00020u, 0xb6d00050u, 0x800800f8u, 0xc00c0074u, 0x200200a2u, 0x50050093u}};
+
+typedef struct {
+    uint2 seed;
+    uint pixelHash;
+    uint sampleIndex;
+    uint dimension;
+} Sampler;
+
+uint hash_uint(uint x) {
+    x ^= x >> 16u;
+    x *= 0x7feb352du;
+    x ^= x >> 15u;
+    x *= 0x846ca68bu;
+    x ^= x >> 16u;
+    return x;
+}
+
+uint hash_combine(const uint seed, const uint value) {
+    return seed ^ (value + (seed << 6u) + (seed >> 2u));
+}
+
+uint reverse_bits(uint x) {
+    x = ((x >> 1u) & 0x55555555u) | ((x & 0x55555555u) << 1u);
+    x = ((x >> 2u) & 0x33333333u) | ((x & 0x33333333u) << 2u);
+    x = ((x >> 4u) & 0x0f0f0f0fu) | ((x & 0x0f0f0f0fu) << 4u);
+    x = ((x >> 8u) & 0x00ff00ffu) | ((x & 0x00ff00ffu) << 8u);
+    return (x >> 16u) | (x << 16u);
+}
+
+uint laine_karras_permutation(uint x, const uint seed) {
+    x += seed;
+    x ^= x * 0x6c50b47cu;
+    x ^= x * 0xb82f1e52u;
+    x ^= x * 0xc7afe638u;
+    x ^= x * 0x8d22f6e6u;
+    return x;
+}
+
+uint nested_uniform_scramble(const uint x, const uint seed) {
+    return reverse_bits(laine_karras_permutation(reverse_bits(x), seed));
+}
+
+uint sobol(uint index, const uint dimension) {
+    uint result = 0u;
+    for (uint bit = 0u; index != 0u; index >>= 1u, bit++) {
+        if (index & 1u) {
+            result ^= SOBOL_DIRECTIONS[dimension][bit];
+        }
+    }
+
+    return result;
+}
+
+float uint_to_unit_float(const uint x) {
+    return (float)(x >> 8u) * SAMPLER_FLOAT_CONSTANT;
+}
+
+uint sampler_dimension_seed(const Sampler *sampler, const uint dimension) {
+    return hash_combine(sampler->pixelHash, hash_uint(dimension));
+}
+
+uint sobol_sample(const Sampler *sampler, const uint dimension) {
+    const uint blockSeed = sampler_dimension_seed(sampler, dimension >> 2u);
+    const uint index = nested_uniform_scramble(sampler->sampleIndex, blockSeed);
+    const uint component = dimension & 3u;
+
+    return nested_uniform_scramble(sobol(index, component), hash_combine(blockSeed, component));
+}
+
+uint rank1_sample(const Sampler *sampler, const uint dimension) {
+    const uint generator = (dimension & 1u) ? RANK1_GENERATOR_Y : RANK1_GENERATOR_X;
+    return sampler->pixelHash + hash_uint(dimension) + sampler->sampleIndex * generator;
+}
+
+Sampler sampler_create(const uint2 pixel, const uint sampleIndex) {
+    Sampler sampler;
+    const uint sampleHash = hash_uint(sampleIndex);
+    sampler.seed = (uint2)(hash_uint(pixel.x) ^ sampleHash, hash_uint(pixel.y) ^ hash_uint(sampleHash));
+    sampler.sampleIndex = sampleIndex;
+    sampler.dimension = 0u;
+
+#if SAMPLER == SAMPLER_RANK1
+    sampler.pixelHash = pixel.x * RANK1_GENERATOR_X + pixel.y * RANK1_GENERATOR_Y;
+#else
+    sampler.pixelHash = hash_uint(pixel.x ^ hash_uint(pixel.y));
+#endif
+
+    return sampler;
+}
+
+void sampler_start_bounce(Sampler *sampler, const uint bounce) {
+    sampler->dimension = SAMPLER_CAMERA_DIMENSIONS + bounce * SAMPLER_BOUNCE_DIMENSIONS;
+}
+
+float sampler_next1f(Sampler *sampler) {
+#if SAMPLER == SAMPLER_PRNG
+    return random1f(&sampler->seed);
+#elif SAMPLER == SAMPLER_SOBOL
+    return uint_to_unit_float(sobol_sample(sampler, sampler->dimension++));
+#else
+    return uint_to_unit_float(rank1_sample(sampler, sampler->dimension++));
+#endif
+}
+
+float2 sampler_next2f(Sampler *sampler) {
+#if SAMPLER == SAMPLER_PRNG
+    return random2f(&sampler->seed);
+#else
+    sampler->dimension = (sampler->dimension + 1u) & ~1u;
+    const float x = sampler_next1f(sampler);
+    const float y = sampler_next1f(sampler);
+    return (float2)(x, y);
+#endif
+}
+
+#endif
@@ -3,6 +3,7 @@
 
 #define RANDOM_CONSTANT 2.32830643654e-10f
 #define TONE_MAPPING_LIMIT 1.5f
+#define SHADOW_RAY_EPSILON 1e-3f
 
 float3 interpolate3(const float3 a, const float3 b, const float3 c, const float u, const float v) {
     return (1.0f - u - v) * a + u * b + v * c;
@@ -1,124 +1,361 @@
+#include "include/camera.h"
+#include "include/config.h"
+#include "include/denoise.h"
 #include "include/lambert.h"
 #include "include/light.h"
 #include "include/material.h"
+#include "include/path_state.h"
 #include "include/ray.h"
+#include "include/sampler.h"
 #include "include/sampling.h"
 #include "include/utilities.h"
 
-__kernel void generate_primary_ray(const float3 position,
-                                   const float3 forward,
-                                   const float3 right,
-                                   const float3 up,
-                                   const float fov,
-                                   const float width,
-                                   const float height,
-                                   const float aspectRatio,
-                                   const uint sampleCount,
-                                   __global Ray *rays) {
-    const uint x = get_global_id(0);
-    const uint y = get_global_id(1);
-    const uint index = x + y * (uint)(width);
+Ray generate_jittered_camera_ray(const Camera *camera, const uint2 pixel, Sampler *sampler) {
+    const float2 random = 2.0f * sampler_next2f(sampler);
+    const float2 jitter = (random < 1.0f) ? (sqrt(random) - 1.0f) : (1.0f - sqrt(2.0f - random));
 
-    uint2 seed = (uint2)(x, y) ^ (uint2)(sampleCount << 16u);
-    const float2 random = 2.0f * random2f(&seed);
+    return generate_camera_ray(camera, (float2)((float)(pixel.x), (float)(pixel.y)) + jitter);
+}
 
-    const float2 jitter = (random < 1.0f) ? (sqrt(random) - 1.0f) : (1.0f - sqrt(2.0f - random));
-    float pixelScreenX = (2.0f * (((float)(x) + jitter.x) / width) - 1.0f) * aspectRatio * fov;
-    float pixelScreenY = (2.0f * (((float)(y) + jitter.y) / height) - 1.0f) * fov;
+__kernel void generate_primary_ray(const Camera camera,
+                                   const uint2 tileOffset,
+                                   const uint sampleIndexOffset,
+                                   __global Ray *rays,
+                                   __global const uint *sampleCounts) {
+    const uint x = get_global_id(0) + tileOffset.x;
+    const uint y = get_global_id(1) + tileOffset.y;
+    const uint index = get_global_id(0) + get_global_id(1) * get_global_size(0);
 
-    Ray primaryRay;
-    primaryRay.origin = position;
-    primaryRay.direction = normalize(pixelScreenX * right + pixelScreenY * up + forward);
-    rays[index] = primaryRay;
+    Sampler sampler = sampler_create((uint2)(x, y), sampleIndexOffset + sampleCounts[index]);
+    rays[index] = generate_jittered_camera_ray(&camera, (uint2)(x, y), &sampler);
 }
 
-__kernel void trace_path(__global Ray *rays,
-                        __global const BVHNode *bvhNodes,
+__kernel void trace_path(__global const Ray *rays,
+                        __global const BVHNode *topLevelNodes,
+                        __global const Instance *instances,
+                        __global const Mesh *meshes,
+                        __global const BVHNode *bottomLevelNodes,
                         __global const Triangle *triangles,
                         __global const Light *lights,
+                        __global const LightAliasEntry *lightAliasTable,
                         const uint lightsCount,
+                        const uint rectangleLightsCount,
                         const uint maxBounces,
-                        const uint sampleCount,
-                        const uint width,
+                        const uint pathStepsBudget,
+                        const uint sampleIndexOffset,
+                        const uint2 tileOffset,
+                        const Camera camera,
                         __global const Material *materials,
-                        __global float3 *radiance) {
-    const uint x = get_global_id(0);
-    const uint y = get_global_id(1);
-    const uint index = x + y * (uint)(width);
-    uint2 seed = (uint2)(x, y) ^ (uint2)(sampleCount << 16u);
+                        __global float4 *radiance,
+                        __global float4 *albedo,
+                        __global float4 *normalDepth,
+                        __global uint *meshRequests,
+                        __global PathState *deferredPaths,
+                        __global uint *sampleCounts
+#if RENDER_STATISTICS
+                        ,
+                        __global uint *rayCounter
+#endif
+) {
+    const uint2 pixel = (uint2)(get_global_id(0) + tileOffset.x, get_global_id(1) + tileOffset.y);
+    const uint index = get_global_id(0) + get_global_id(1) * get_global_size(0);
+    uint pathSampleIndex = sampleIndexOffset + sampleCounts[index];
+    uint nextSampleIndex = pathSampleIndex + 1u;
+    Sampler sampler = sampler_create(pixel, pathSampleIndex);
 
-    Ray *ray = &rays[index];
+    Ray ray = rays[index];
     float3 throughput = 1.0f;
-    for (uint bounce = 0u; bounce <= maxBounces; bounce++) {
-        Hit hit = intersect_ray_bvh(ray, bvhNodes, triangles);
+    float3 pathRadiance = 0.0f;
+    float4 pathAlbedo = 0.0f;
+    float4 pathNormalDepth = 0.0f;
+    float4 pixelRadiance = 0.0f;
+    float4 pixelAlbedo = 0.0f;
+    float4 pixelNormalDepth = 0.0f;
+    uint bounce = 0u;
+    uint raysCount = 0u;
+
+    const PathState deferredPath = deferredPaths[index];
+    if (deferredPath.isActive != 0u) {
+        pathSampleIndex = deferredPath.sampleIndex;
+        nextSampleIndex = sampleIndexOffset + sampleCounts[index];
+        sampler = sampler_create(pixel, pathSampleIndex);
+        sampler.seed = deferredPath.seed;
+
+        ray.origin = deferredPath.origin.xyz;
+        ray.direction = deferredPath.direction.xyz;
+        throughput = deferredPath.throughput.xyz;
+        pathRadiance = deferredPath.radiance.xyz;
+        pathAlbedo = deferredPath.albedo;
+        pathNormalDepth = deferredPath.normalDepth;
+        bounce = deferredPath.bounce;
+        deferredPaths[index].isActive = 0u;
+    }
+
+    for (uint step = 0u; step < pathStepsBudget; step++) {
+        sampler_start_bounce(&sampler, bounce);
+        const Ray bounceRay = ray;
+        const float3 bounceThroughput = throughput;
+        const float3 bounceRadiance = pathRadiance;
+        const uint2 bounceSeed = sampler.seed;
+        Hit hit = intersect_scene(&ray, topLevelNodes, instances, meshes, bottomLevelNodes, triangles, meshRequests);
+        raysCount++;
+
+        bool isPathDeferred = hit.isDeferred;
+        bool isPathTerminated = isPathDeferred || !hit.isHit || (bounce == maxBounces);
+        if (hit.isHit && !isPathDeferred) {
+            const Triangle *triangle = &triangles[hit.triangleIndex];
+            const Instance *instance = &instances[hit.instanceIndex];
+            const float3 intersectionPoint = ray.origin + hit.tNearest * ray.direction;
+            const float3 objectNormal = interpolate3(triangle->v0.normal, triangle->v1.normal, triangle->v2.normal, hit.u, hit.v);
+            const float3 normal = transform_normal(instance->worldToObject, objectNormal);
+            const Material *material = &materials[triangle->materialIndex];
+
+            bool isLightHit = false;
+            if (bounce == 0u) {
+                pathAlbedo = (float4)(material->diffuse, 0.0f);
+                pathNormalDepth = (float4)(normal, hit.tNearest);
+                pathRadiance += (material->emissive * throughput);
+
+                for (uint i = 0u; i < rectangleLightsCount; i++) {
+                    const Light *light = &lights[i];
+                    if (intersect_ray_light(&ray, light, &hit)) {
+                        pathRadiance += (light->emission * throughput);
+                        isLightHit = true;
+                        break;
+                    }
+                }
+            }
+
+            if (!isLightHit) {
+                if (lightsCount > 0u) {
+                    float lightPmf;
+                    const uint lightIndex = sample_light_alias_table(lightAliasTable, lightsCount, sampler_next1f(&sampler), &lightPmf);
+                    const Light *light = &lights[lightIndex];
+
+                    LightSample lightSample = sample_light(light, intersectionPoint, sampler_next2f(&sampler));
+                    lightSample.pdf *= lightPmf;
+                    if (dot(lightSample.direction, lightSample.normal) < 0.0f && lightSample.pdf > 0.0f) {
+                        Ray shadowRay;
+                        shadowRay.origin = intersectionPoint;
+                        shadowRay.direction = lightSample.direction;
+                        Hit shadowHit = intersect_scene(&shadowRay, topLevelNodes, instances, meshes, bottomLevelNodes, triangles, meshRequests);
+                        raysCount++;
+
+                        const bool isOccluded = shadowHit.tNearest < lightSample.distance - SHADOW_RAY_EPSILON;
+                        isPathDeferred = !isOccluded && (shadowHit.tDeferred < lightSample.distance - SHADOW_RAY_EPSILON);
+                        if (!isOccluded && !isPathDeferred) {
+                            const BRDFSample brdfSample = evaluate_lambert_brdf(material, normal, lightSample.direction);
+                            const float3 Li = light->emission;
+                            const float3 Ld = (Li * brdfSample.brdf * brdfSample.cosTheta) / lightSample.pdf;
 
-        if (!hit.isHit) {
+                            if (brdfSample.pdf > 0.0f) {
+                                pathRadiance += (Ld * throughput);
+                            }
+                        }
+                    }
+                }
+
+                BRDFSample brdfSample = sample_lambert_brdf(material, normal, sampler_next2f(&sampler));
+
+                ray.direction = brdfSample.direction;
+                ray.origin = intersectionPoint + ray.direction * FLT_EPSILON;
+
+                const float3 Lr = (brdfSample.brdf * brdfSample.cosTheta) / brdfSample.pdf;
+                throughput *= Lr;
+
+                if (bounce > 3u) {
+                    const float throughputMax = max(throughput.x, max(throughput.y, throughput.z));
+                    const float q = max(0.05f, 1.0f - throughputMax);
+                    if (sampler_next1f(&sampler) < q) {
+                        isPathTerminated = true;
+                    }
+                    throughput /= (1.0f - q);
+                }
+            }
+
+            isPathTerminated |= isLightHit;
+        }
+
+        if (isPathDeferred) {
+            store_path_state(&deferredPaths[index], &bounceRay, bounceThroughput, bounceRadiance, pathAlbedo, pathNormalDepth, bounceSeed, pathSampleIndex, bounce);
             break;
         }
 
-        const Triangle *triangle = &triangles[hit.triangleIndex];
-        const float3 intersectionPoint = ray->origin + hit.tNearest * ray->direction;
-        const float3 normal = interpolate3(triangle->v0.normal, triangle->v1.normal, triangle->v2.normal, hit.u, hit.v);
-        const Material *material = &materials[triangle->materialIndex];
+        if (!isPathTerminated) {
+            bounce++;
+            continue;
+        }
 
-        radiance[index] += (material->emissive * throughput);
+        pixelRadiance += (float4)(pathRadiance, 1.0f);
+        pixelAlbedo += pathAlbedo;
+        pixelNormalDepth += pathNormalDepth;
 
-        const Light *light = &lights[0];
-        if (intersect_ray_light(ray, light, &hit) && (bounce == 0u)) {
-            radiance[index] += (light->emission * throughput);
+        if (pathStepsBudget - step - 1u <= maxBounces) {
             break;
         }
 
-        LightSample lightSample = sample_rectangle_light(light, intersectionPoint, random2f(&seed));
-        if (dot(lightSample.direction, lightSample.normal) < 0.0f) {
-            Ray shadowRay;
-            shadowRay.origin = intersectionPoint;
-            shadowRay.direction = lightSample.direction;
-            Hit shadowHit = intersect_ray_bvh(&shadowRay, bvhNodes, triangles);
+        pathSampleIndex = nextSampleIndex++;
+        sampler = sampler_create(pixel, pathSampleIndex);
+        ray = generate_jittered_camera_ray(&camera, pixel, &sampler);
+        throughput = 1.0f;
+        pathRadiance = 0.0f;
+        pathAlbedo = 0.0f;
+        pathNormalDepth = 0.0f;
+        bounce = 0u;
+    }
 
-            if (shadowHit.tNearest >= lightSample.distance) {
-                const BRDFSample brdfSample = evaluate_lambert_brdf(material, normal, lightSample.direction);
-                const float3 Li = light->emission;
-                const float3 Ld = (Li * brdfSample.brdf * brdfSample.cosTheta) / lightSample.pdf;
+    radiance[index] += pixelRadiance;
+    albedo[index] += pixelAlbedo;
+    normalDepth[index] += pixelNormalDepth;
+    sampleCounts[index] = nextSampleIndex - sampleIndexOffset;
+#if RENDER_STATISTICS
+    atomic_add(rayCounter, raysCount);
+#endif
+}
 
-                if (brdfSample.pdf > 0.0f) {
-                    radiance[index] += (Ld * throughput);
-                }
-            }
-        }
+__kernel void reproject_history(const Camera camera,
+                                const Camera previousCamera,
+                                __global float4 *radiance,
+                                __global float4 *albedo,
+                                __global float4 *normalDepth,
+                                __global const float4 *historyRadiance,
+                                __global const float4 *historyAlbedo,
+                                __global const float4 *historyNormalDepth,
+                                const float maxHistorySamples,
+                                const float depthThreshold,
+                                const float normalThreshold) {
+    const uint x = get_global_id(0);
+    const uint y = get_global_id(1);
+    const uint index = x + y * (uint)(camera.width);
 
-        BRDFSample brdfSample = sample_lambert_brdf(material, normal, random2f(&seed));
-        
-        ray->direction = brdfSample.direction;
-        ray->origin = intersectionPoint + ray->direction * FLT_EPSILON;
-        
-        const float3 Lr = (brdfSample.brdf * brdfSample.cosTheta) / brdfSample.pdf;
-        throughput *= Lr;
-
-        if (bounce > 3u) {
-            const float throughputMax = max(throughput.x, max(throughput.y, throughput.z));
-            const float q = max(0.05f, 1.0f - throughputMax);
-            if (random1f(&seed) < q) {
-                break;
+    const float samples = max(radiance[index].w, 1.0f);
+    const float4 currentNormalDepth = normalDepth[index];
+    const float depth = currentNormalDepth.w / samples;
+    if (depth <= 0.0f) {
+        return;
+    }
+
+    const Ray ray = generate_camera_ray(&camera, (float2)((float)(x), (float)(y)));
+    const float3 position = ray.origin + ray.direction * depth;
+
+    int2 previousPixel;
+    float previousDistance;
+    if (!project_to_camera(&previousCamera, position, &previousPixel, &previousDistance)) {
+        return;
+    }
+
+    const uint historyIndex = previousPixel.x + previousPixel.y * (uint)(previousCamera.width);
+    const float4 history = historyRadiance[historyIndex];
+    if (history.w <= 0.0f) {
+        return;
+    }
+
+    const float4 historyFeatures = historyNormalDepth[historyIndex];
+    const float historyDepth = historyFeatures.w / history.w;
+    if (fabs(historyDepth - previousDistance) > depthThreshold * previousDistance) {
+        return;
+    }
+
+    if (dot(feature_normal(historyFeatures), feature_normal(currentNormalDepth)) < normalThreshold) {
+        return;
+    }
+
+    const float historyWeight = min(1.0f, maxHistorySamples / history.w);
+    radiance[index] += history * historyWeight;
+    albedo[index] += historyAlbedo[historyIndex] * historyWeight;
+    normalDepth[index] += historyFeatures * historyWeight;
+}
+
+__kernel void compute_pixel(__write_only image2d_t imagePlane,
+                            __global const float4 *radiance) {
+    const uint x = get_global_id(0);
+    const uint y = get_global_id(1);
+    const uint index = x + get_image_width(imagePlane) * y;
+
+    const float4 accumulatedRadiance = radiance[index];
+    const float3 color = accumulatedRadiance.xyz / max(accumulatedRadiance.w, 1.0f);
+    const float3 gammaCorrectedColor = gamma_correction(color);
+    const float3 toneMappedColor = tone_mapping(gammaCorrectedColor);
+
+    write_imagef(imagePlane, (int2)(x, y), (float4)(toneMappedColor, 1.0f));
+}
+
+__kernel void prepare_denoise(__global const float4 *radiance,
+                              __global const float4 *albedo,
+                              __global float4 *color) {
+    const uint index = get_global_id(0) + get_global_id(1) * get_global_size(0);
+    const float4 accumulatedRadiance = radiance[index];
+    const float samples = max(accumulatedRadiance.w, 1.0f);
+
+    const float3 averageAlbedo = albedo[index].xyz / samples;
+    color[index] = (float4)(demodulate_albedo(accumulatedRadiance.xyz / samples, averageAlbedo), samples);
+}
+
+__kernel void denoise_atrous(__global const float4 *input,
+                             __global float4 *output,
+                             __global const float4 *normalDepth,
+                             const uint stepWidth,
+                             const float colorPhi,
+                             const float normalPhi,
+                             const float depthPhi) {
+    const int2 pixel = (int2)(get_global_id(0), get_global_id(1));
+    const int2 size = (int2)(get_global_size(0), get_global_size(1));
+    const uint index = pixel.x + pixel.y * size.x;
+
+    const float4 centerColor = input[index];
+    const float3 centerNormal = feature_normal(normalDepth[index]);
+    const float centerDepth = normalDepth[index].w / centerColor.w;
+
+    float3 colorSum = 0.0f;
+    float weightSum = 0.0f;
+    for (int dy = -2; dy <= 2; dy++) {
+        for (int dx = -2; dx <= 2; dx++) {
+            const int2 neighbour = pixel + (int2)(dx, dy) * (int)(stepWidth);
+            if (neighbour.x < 0 || neighbour.y < 0 || neighbour.x >= size.x || neighbour.y >= size.y) {
+                continue;
             }
-            throughput /= (1.0f - q);
+
+            const uint neighbourIndex = neighbour.x + neighbour.y * size.x;
+            const float4 neighbourColor = input[neighbourIndex];
+            const float4 neighbourNormalDepth = normalDepth[neighbourIndex];
+            const float weight = atrous_kernel_weight(dx, dy) *
+                                 edge_stopping_weight(centerColor.xyz, neighbourColor.xyz,
+                                                      centerNormal, feature_normal(neighbourNormalDepth),
+                                                      centerDepth, neighbourNormalDepth.w / neighbourColor.w,
+                                                      colorPhi, normalPhi, depthPhi * (float)(stepWidth));
+
+            colorSum += neighbourColor.xyz * weight;
+            weightSum += weight;
         }
     }
+
+    output[index] = (float4)(colorSum / max(weightSum, FLT_EPSILON), centerColor.w);
 }
 
-__kernel void compute_pixel(__read_write image2d_t imagePlane,
-                            __global const float3 *radiance,
-                            const uint sampleCount) {
+__kernel void compute_denoised_pixel(__write_only image2d_t imagePlane,
+                                     __global const float4 *color,
+                                     __global const float4 *albedo) {
     const uint x = get_global_id(0);
     const uint y = get_global_id(1);
     const uint index = x + get_image_width(imagePlane) * y;
 
-    const float samples = (float)sampleCount;
-    const float3 previousRadiance = read_imagef(imagePlane, (int2)(x, y)).xyz;
-    const float3 newRadiance = radiance[index] / samples;
-    const float3 color = mix(newRadiance, previousRadiance, 1.0f / (samples + 1.0f));
-    const float3 gammaCorrectedColor = gamma_correction(color);
+    const float4 denoisedColor = color[index];
+    const float3 averageAlbedo = albedo[index].xyz / denoisedColor.w;
+    const float3 remodulatedColor = remodulate_albedo(denoisedColor.xyz, averageAlbedo);
+    const float3 gammaCorrectedColor = gamma_correction(remodulatedColor);
     const float3 toneMappedColor = tone_mapping(gammaCorrectedColor);
 
     write_imagef(imagePlane, (int2)(x, y), (float4)(toneMappedColor, 1.0f));
 }
+
+__kernel void draw_progress(__write_only image2d_t imagePlane,
+                            const float progress) {
+    const int2 pixel = (int2)(get_global_id(0), get_global_id(1));
+    const float2 uv = (float2)((float)(pixel.x) / get_image_width(imagePlane), (float)(pixel.y) / get_image_height(imagePlane));
+
+    const bool isInsideBar = uv.x >= 0.25f && uv.x <= 0.75f && uv.y >= 0.49f && uv.y <= 0.51f;
+    const bool isFilled = uv.x <= 0.25f + 0.5f * clamp(progress, 0.0f, 1.0f);
+    const float3 color = isInsideBar ? (isFilled ? (float3)(0.9f) : (float3)(0.25f)) : (float3)(0.05f);
+
+    write_imagef(imagePlane, pixel, (float4)(color, 1.0f));
+}
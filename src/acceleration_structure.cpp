@@ -0,0 +1,205 @@
+#include "acceleration_structure.h"
+#include "scene.h"
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <numeric>
+#include <utility>
+
+namespace NOXPT {
+
+    namespace {
+
+        constexpr size_t s_maxChunkTrianglesCount = 1u << 16u;
+
+        float centroid(const KernelTypes::Triangle &triangle, const int axis) {
+            return (triangle.v0.position.s[axis] + triangle.v1.position.s[axis] + triangle.v2.position.s[axis]) / 3.0f;
+        }
+
+        void splitChunks(const KernelTypes::Triangle *triangles, std::vector<uint32_t> &triangleIndices, const size_t first, const size_t last, std::vector<std::pair<size_t, size_t>> &chunkRanges) {
+            if (last - first <= s_maxChunkTrianglesCount) {
+                chunkRanges.emplace_back(first, last);
+                return;
+            }
+
+            NOX::BoundingBox centroidBounds{};
+            for (auto i = first; i < last; i++) {
+                const auto &triangle = triangles[triangleIndices[i]];
+                centroidBounds.grow(glm::vec3(centroid(triangle, 0), centroid(triangle, 1), centroid(triangle, 2)));
+            }
+
+            const auto axis = centroidBounds.maximumExtentAxis();
+            const auto middle = first + (last - first) / 2u;
+            std::nth_element(triangleIndices.begin() + first, triangleIndices.begin() + middle, triangleIndices.begin() + last,
+                             [triangles, axis](const uint32_t a, const uint32_t b) {
+                                 return centroid(triangles[a], axis) < centroid(triangles[b], axis);
+                             });
+
+            splitChunks(triangles, triangleIndices, first, middle, chunkRanges);
+            splitChunks(triangles, triangleIndices, middle, last, chunkRanges);
+        }
+
+        void setMatrixRows(cl_float4 *rows, const glm::mat4 &matrix) {
+            for (auto row = 0; row < 3; row++) {
+                rows[row] = {matrix[0][row], matrix[1][row], matrix[2][row], matrix[3][row]};
+            }
+        }
+
+        NOX::BoundingBox transformBounds(const NOX::BoundingBox &bounds, const glm::mat4 &transform) {
+            NOX::BoundingBox transformedBounds{};
+            for (auto corner = 0u; corner < 8u; corner++) {
+                const glm::vec3 point{(corner & 1u) ? bounds.maximum().x : bounds.minimum().x,
+                                      (corner & 2u) ? bounds.maximum().y : bounds.minimum().y,
+                                      (corner & 4u) ? bounds.maximum().z : bounds.minimum().z};
+                transformedBounds.grow(glm::vec3(transform * glm::vec4(point, 1.0f)));
+            }
+
+            return transformedBounds;
+        }
+
+    } // namespace
+
+    float AccelerationStructure::getInitialCost() const {
+        auto cost = 0.0f;
+        for (const auto &chunk : m_chunks) {
+            cost += chunk.initialCost * static_cast<float>(chunk.trianglesCount);
+        }
+
+        return m_chunkTriangles.empty() ? 0.0f : cost / static_cast<float>(m_chunkTriangles.size());
+    }
+
+    float AccelerationStructure::getCost() const {
+        auto cost = 0.0f;
+        for (const auto &chunk : m_chunks) {
+            cost += chunk.cost * static_cast<float>(chunk.trianglesCount);
+        }
+
+        return m_chunkTriangles.empty() ? 0.0f : cost / static_cast<float>(m_chunkTriangles.size());
+    }
+
+    void AccelerationStructure::build(const Scene &scene) {
+        AccelerationStructure previous{};
+        previous.m_chunks = std::move(m_chunks);
+        previous.m_meshChunks = std::move(m_meshChunks);
+        previous.m_chunkTriangles = std::move(m_chunkTriangles);
+        m_chunks.clear();
+        m_meshChunks.clear();
+        m_chunkNodes.clear();
+        m_chunkTriangles.clear();
+
+        const auto &meshes = scene.getMeshes();
+        size_t pendingTrianglesCount = 0u;
+        for (const auto &mesh : meshes) {
+            pendingTrianglesCount += mesh.trianglesCount;
+        }
+
+        // A chunk never has more nodes than triangles; capacity that is never written is never touched.
+        m_chunkNodes.reserve(pendingTrianglesCount);
+        m_chunkTriangles.reserve(pendingTrianglesCount);
+
+        BVH bvh;
+        bvh.setNodeLayout(m_nodeLayout);
+        for (uint32_t i = 0u; i < meshes.size(); i++) {
+            const KernelTypes::Triangle *triangles = meshes[i].triangles.data();
+            auto trianglesCount = meshes[i].triangles.size();
+            if (trianglesCount == 0u) {
+                previous.getMeshTriangles(i, triangles, trianglesCount);
+            }
+
+            buildMeshChunks(triangles, trianglesCount, pendingTrianglesCount, bvh);
+        }
+
+        buildTopLevel(scene);
+    }
+
+    void AccelerationStructure::update(const Scene &scene) {
+        const auto &meshes = scene.getMeshes();
+
+        size_t pendingTrianglesCount = 0u;
+        for (auto i = m_meshChunks.size(); i < meshes.size(); i++) {
+            pendingTrianglesCount += meshes[i].trianglesCount;
+        }
+
+        m_chunkNodes.reserve(m_chunkNodes.size() + pendingTrianglesCount);
+        m_chunkTriangles.reserve(m_chunkTriangles.size() + pendingTrianglesCount);
+
+        BVH bvh;
+        bvh.setNodeLayout(m_nodeLayout);
+        for (auto i = m_meshChunks.size(); i < meshes.size(); i++) {
+            buildMeshChunks(meshes[i].triangles.data(), meshes[i].triangles.size(), pendingTrianglesCount, bvh);
+        }
+
+        buildTopLevel(scene);
+    }
+
+    void AccelerationStructure::buildMeshChunks(const KernelTypes::Triangle *triangles, size_t trianglesCount, size_t pendingTrianglesCount, BVH &bvh) {
+        std::vector<uint32_t> triangleIndices(trianglesCount);
+        std::iota(triangleIndices.begin(), triangleIndices.end(), 0u);
+
+        std::vector<std::pair<size_t, size_t>> chunkRanges{};
+        if (trianglesCount > 0u) {
+            splitChunks(triangles, triangleIndices, 0u, trianglesCount, chunkRanges);
+        }
+
+        m_meshChunks.push_back({static_cast<uint32_t>(m_chunks.size()), static_cast<uint32_t>(chunkRanges.size())});
+        for (const auto &[first, last] : chunkRanges) {
+            const auto nodeOffset = m_chunkNodes.size();
+            const auto triangleOffset = m_chunkTriangles.size();
+            const auto chunkTrianglesCount = static_cast<uint32_t>(last - first);
+            m_chunkTriangles.resize(triangleOffset + chunkTrianglesCount);
+
+            bvh.setOptimizationBudget(m_optimizationBudget * static_cast<std::chrono::milliseconds::rep>(chunkTrianglesCount) / static_cast<std::chrono::milliseconds::rep>(pendingTrianglesCount));
+            const auto nodesCount = bvh.build(triangles, triangleIndices.data() + first, chunkTrianglesCount, [this, nodeOffset](size_t nodesCount) {
+                m_chunkNodes.resize(nodeOffset + nodesCount);
+                return m_chunkNodes.data() + nodeOffset;
+            }, m_chunkTriangles.data() + triangleOffset);
+
+            m_chunks.push_back({static_cast<uint32_t>(nodeOffset), nodesCount, static_cast<uint32_t>(triangleOffset), chunkTrianglesCount, bvh.getBounds(), bvh.getInitialCost(), bvh.getCost()});
+        }
+    }
+
+    void AccelerationStructure::getMeshTriangles(uint32_t meshIndex, const KernelTypes::Triangle *&triangles, size_t &trianglesCount) const {
+        triangles = nullptr;
+        trianglesCount = 0u;
+        if (meshIndex >= m_meshChunks.size() || m_meshChunks[meshIndex].chunksCount == 0u) {
+            return;
+        }
+
+        const auto &meshChunks = m_meshChunks[meshIndex];
+        const auto &firstChunk = m_chunks[meshChunks.firstChunk];
+        const auto &lastChunk = m_chunks[meshChunks.firstChunk + meshChunks.chunksCount - 1u];
+        triangles = m_chunkTriangles.data() + firstChunk.triangleOffset;
+        trianglesCount = lastChunk.triangleOffset + lastChunk.trianglesCount - firstChunk.triangleOffset;
+    }
+
+    void AccelerationStructure::buildTopLevel(const Scene &scene) {
+        std::vector<NOX::BoundingBox> instancesBounds{};
+        std::vector<std::pair<const Instance *, uint32_t>> instances{};
+        for (const auto &instance : scene.getInstances()) {
+            const auto &meshChunks = m_meshChunks[instance.meshIndex];
+            for (auto chunkIndex = meshChunks.firstChunk; chunkIndex < meshChunks.firstChunk + meshChunks.chunksCount; chunkIndex++) {
+                instancesBounds.push_back(transformBounds(m_chunks[chunkIndex].bounds, instance.transform));
+                instances.emplace_back(&instance, chunkIndex);
+            }
+        }
+
+        BVH bvh;
+        bvh.setNodeLayout(m_nodeLayout);
+        bvh.build(instancesBounds, 1u);
+        m_topLevelNodes.assign(bvh.getBvhNodes().begin(), bvh.getBvhNodes().end());
+
+        m_instances.clear();
+        m_instances.reserve(instances.size());
+        for (const auto index : bvh.getPrimitiveIndices()) {
+            const auto &[instance, chunkIndex] = instances[index];
+
+            KernelTypes::Instance newInstance{};
+            setMatrixRows(newInstance.objectToWorld, instance->transform);
+            setMatrixRows(newInstance.worldToObject, glm::inverse(instance->transform));
+            newInstance.meshIndex = chunkIndex;
+            m_instances.push_back(newInstance);
+        }
+    }
+
+} // namespace NOXPT
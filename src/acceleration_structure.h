@@ -0,0 +1,66 @@
+#pragma once
+
+#include "bvh.h"
+#include "kernel_types.h"
+#include "page_aligned_allocator.h"
+
+#include <nox/maths/bounding_box.h>
+
+#include <chrono>
+#include <vector>
+
+namespace NOXPT {
+
+    class Scene;
+
+    struct GeometryChunk {
+        uint32_t nodeOffset{};
+        uint32_t nodesCount{};
+        uint32_t triangleOffset{};
+        uint32_t trianglesCount{};
+        NOX::BoundingBox bounds{};
+        float initialCost{};
+        float cost{};
+    };
+
+    class AccelerationStructure {
+      public:
+        const PageAlignedVector<KernelTypes::BVHNode> &getTopLevelNodes() const { return m_topLevelNodes; }
+        const PageAlignedVector<KernelTypes::Instance> &getInstances() const { return m_instances; }
+        const std::vector<GeometryChunk> &getChunks() const { return m_chunks; }
+        const PageAlignedVector<KernelTypes::BVHNode> &getChunkNodes() const { return m_chunkNodes; }
+        const PageAlignedVector<KernelTypes::Triangle> &getChunkTriangles() const { return m_chunkTriangles; }
+        size_t getTrianglesCount() const { return m_chunkTriangles.size(); }
+        BVHNodeLayout getNodeLayout() const { return m_nodeLayout; }
+        void setNodeLayout(const BVHNodeLayout layout) { m_nodeLayout = layout; }
+        std::chrono::milliseconds getOptimizationBudget() const { return m_optimizationBudget; }
+        void setOptimizationBudget(const std::chrono::milliseconds budget) { m_optimizationBudget = budget; }
+        float getInitialCost() const;
+        float getCost() const;
+
+        void build(const Scene &scene);
+        void update(const Scene &scene);
+        void buildTopLevel(const Scene &scene);
+        void getMeshTriangles(uint32_t meshIndex, const KernelTypes::Triangle *&triangles, size_t &trianglesCount) const;
+
+      private:
+        struct MeshChunks {
+            uint32_t firstChunk{};
+            uint32_t chunksCount{};
+        };
+
+      private:
+        void buildMeshChunks(const KernelTypes::Triangle *triangles, size_t trianglesCount, size_t pendingTrianglesCount, BVH &bvh);
+
+      private:
+        PageAlignedVector<KernelTypes::BVHNode> m_topLevelNodes{};
+        PageAlignedVector<KernelTypes::Instance> m_instances{};
+        std::vector<GeometryChunk> m_chunks{};
+        std::vector<MeshChunks> m_meshChunks{};
+        PageAlignedVector<KernelTypes::BVHNode> m_chunkNodes{};
+        PageAlignedVector<KernelTypes::Triangle> m_chunkTriangles{};
+        BVHNodeLayout m_nodeLayout{BVHNodeLayout::DEPTH_FIRST};
+        std::chrono::milliseconds m_optimizationBudget{0};
+    };
+
+} // namespace NOXPT
@@ -6,24 +6,75 @@
 
 #include <nox/renderer/renderer.h>
 
+#include <iostream>
+
 namespace NOXPT {
 
+    namespace {
+
+        constexpr const char *s_modelPath = "assets/models/cornell_box/cornell_box.obj";
+        constexpr float s_sceneLoadingProgress = 0.5f;
+        constexpr float s_pathTracerInitializationProgress = 0.75f;
+
+        float elapsedMilliseconds(const std::chrono::steady_clock::time_point &startTime) {
+            return std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+        }
+
+    } // namespace
+
     Application::Application(const NOX::ApplicationSpecification &specification) : NOX::Application(specification),
-                                                                                   m_pathTracer(m_cameraController.getCamera(), m_scene) {
+                                                                                   m_modelLoader(s_modelPath),
+                                                                                   m_sceneLoading(std::async(std::launch::async, &ModelLoader::load, &m_modelLoader, std::ref(m_modelData))),
+                                                                                   m_pathTracer(m_cameraController.getCamera(), m_scene, Benchmark::getKernelProgramSettings(specification.arguments)),
+                                                                                   m_renderFarm(m_pathTracer, specification.arguments[0]),
+                                                                                   m_arguments(specification.arguments) {
+        std::cout << "Startup: kernels compiled after " << elapsedMilliseconds(m_startupTime) << " ms" << std::endl;
+
+        if (RenderFarm::isWorker(m_arguments) || Benchmark::isBenchmark(m_arguments)) {
+            auto kernelTuningSettings = m_pathTracer.getKernelTuningSettings();
+            kernelTuningSettings.enabled = false;
+            m_pathTracer.setKernelTuningSettings(kernelTuningSettings);
+        }
+
         m_eventDispatcher.getKeyEventDelegate().subscribe([this](const NOX::KeyEvent &event) {
-            if (event.getAction() == NOX::Action::PRESSED) {
+            if (event.getAction() == NOX::Action::PRESSED && m_startupStage == StartupStage::READY && !m_pathTracer.isRenderingTiles()) {
                 switch (event.getKey()) {
                 case NOX::Key::ESCAPE:
                     m_cameraController.focus();
                     break;
+                case NOX::Key::F: {
+                    auto denoiserSettings = m_pathTracer.getDenoiserSettings();
+                    denoiserSettings.enabled = !denoiserSettings.enabled;
+                    m_pathTracer.setDenoiserSettings(denoiserSettings);
+                    break;
+                }
+                case NOX::Key::T: {
+                    auto reprojectionSettings = m_pathTracer.getReprojectionSettings();
+                    reprojectionSettings.enabled = !reprojectionSettings.enabled;
+                    m_pathTracer.setReprojectionSettings(reprojectionSettings);
+                    break;
+                }
+                case NOX::Key::L:
+                    m_pathTracer.setNodeLayout(m_pathTracer.getNodeLayout() == BVHNodeLayout::TREELET ? BVHNodeLayout::DEPTH_FIRST : BVHNodeLayout::TREELET);
+                    break;
+                case NOX::Key::O: {
+                    auto bvhOptimizationSettings = m_pathTracer.getBVHOptimizationSettings();
+                    bvhOptimizationSettings.enabled = !bvhOptimizationSettings.enabled;
+                    m_pathTracer.setBVHOptimizationSettings(bvhOptimizationSettings);
+                    break;
+                }
+                case NOX::Key::K:
+                    m_pathTracer.tuneKernels(true);
+                    break;
+                case NOX::Key::P:
+                    m_pathTracer.renderTiled(TiledRenderSettings{});
+                    break;
+                case NOX::Key::R:
+                    m_renderFarm.render(RenderFarmSettings{});
+                    break;
                 }
             }
         });
-
-        m_scene.addModel(m_assetManager.loadAssetImmediate<NOX::Model>("cornellBox", "assets/models/cornell_box/cornell_box.obj"));
-        m_scene.addRectangleLight(NOX::RectangleLight({0.0f, 1.985f, 0.0f}, 0.5f, 0.5f, {17.0f, 12.0f, 4.0f}));
-
-        m_pathTracer.initialize();
     }
 
     Application::~Application() {}
@@ -37,7 +88,93 @@ namespace NOXPT {
         return new Application(specification);
     }
 
+    bool Application::runWorker() {
+        if (!RenderFarm::isWorker(m_arguments)) {
+            return false;
+        }
+
+        initialize();
+        return m_renderFarm.runWorker(m_arguments);
+    }
+
+    bool Application::runBenchmark() {
+        if (!Benchmark::isBenchmark(m_arguments)) {
+            return false;
+        }
+
+        initialize();
+        Benchmark(m_pathTracer, m_scene).run(m_arguments);
+        return true;
+    }
+
+    void Application::initialize() {
+        m_sceneLoading.wait();
+        loadScene();
+        m_pathTracer.startInitialization();
+        m_pathTracer.finishInitialization();
+        m_startupStage = StartupStage::READY;
+    }
+
+    void Application::loadScene() {
+        if (m_sceneLoading.get()) {
+            m_scene.addModel(std::move(m_modelData));
+        } else {
+            m_scene.addModel(std::make_shared<NOX::Model>(m_modelLoader.getPath()));
+        }
+        m_scene.addRectangleLight(NOX::RectangleLight({0.0f, 1.985f, 0.0f}, 0.5f, 0.5f, {17.0f, 12.0f, 4.0f}));
+    }
+
+    void Application::updateStartup() {
+        switch (m_startupStage) {
+        case StartupStage::LOADING_SCENE:
+            if (m_sceneLoading.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+                return;
+            }
+
+            loadScene();
+            std::cout << "Startup: scene loaded after " << elapsedMilliseconds(m_startupTime) << " ms" << std::endl;
+            m_pathTracer.startInitialization();
+            m_startupStage = StartupStage::INITIALIZING_PATH_TRACER;
+            [[fallthrough]];
+        case StartupStage::INITIALIZING_PATH_TRACER:
+            if (!m_pathTracer.isInitializationReady()) {
+                return;
+            }
+
+            m_pathTracer.finishInitialization();
+            std::cout << "Startup: path tracer initialized after " << elapsedMilliseconds(m_startupTime) << " ms" << std::endl;
+            m_startupStage = StartupStage::READY;
+            break;
+        case StartupStage::READY:
+            break;
+        }
+    }
+
+    float Application::getStartupProgress() const {
+        switch (m_startupStage) {
+        case StartupStage::LOADING_SCENE:
+            return s_sceneLoadingProgress * m_modelLoader.getProgress();
+        case StartupStage::INITIALIZING_PATH_TRACER:
+            return s_pathTracerInitializationProgress;
+        case StartupStage::READY:
+            break;
+        }
+
+        return 1.0f;
+    }
+
     void Application::onUpdate(float timestep) {
+        if (m_startupStage != StartupStage::READY) {
+            updateStartup();
+        }
+
+        if (m_startupStage != StartupStage::READY) {
+            m_pathTracer.drawProgress(getStartupProgress());
+            NOX::Renderer::clear();
+            NOX::Renderer::drawFullscreenTexture(*m_pathTracer.getOutputTexture());
+            return;
+        }
+
         m_cameraController.rotate(m_cameraSensitivity);
         if (NOX::Input::isKeyPressed(NOX::Key::W)) {
             m_cameraController.move(NOX::CameraController::Direction::FORWARDS, m_cameraMovementSpeed * timestep);
@@ -59,7 +196,7 @@ namespace NOXPT {
         }
 
         if (m_cameraController.isFocused()) {
-            m_pathTracer.reset();
+            m_pathTracer.invalidateHistory();
         }
 
         m_pathTracer.onUpdate();
@@ -1,14 +1,28 @@
 #pragma once
 
+#include "benchmark.h"
+#include "model_loader.h"
 #include "path_tracer.h"
+#include "render_farm.h"
 #include "scene.h"
 
 #include <nox/application.h>
 
 #include <nox/graphics/camera_controller.h>
+#include <nox/graphics/model.h>
+
+#include <chrono>
+#include <future>
+#include <memory>
 
 namespace NOXPT {
 
+    enum class StartupStage {
+        LOADING_SCENE,
+        INITIALIZING_PATH_TRACER,
+        READY
+    };
+
     class Application : public NOX::Application {
       public:
         explicit Application(const NOX::ApplicationSpecification &specification);
@@ -16,15 +30,31 @@ namespace NOXPT {
 
         [[nodiscard]] static Application *createApplication(NOX::ApplicationCommandLineArguments arguments);
 
+        bool runWorker();
+        bool runBenchmark();
         void onUpdate(float timestep) override;
 
+      private:
+        void loadScene();
+        void initialize();
+        void updateStartup();
+        float getStartupProgress() const;
+
       private:
         NOX::CameraController m_cameraController{};
         float m_cameraMovementSpeed{2.5f};
         float m_cameraSensitivity{0.05f};
 
+        StartupStage m_startupStage{StartupStage::LOADING_SCENE};
+        std::chrono::steady_clock::time_point m_startupTime{std::chrono::steady_clock::now()};
+
         Scene m_scene{};
+        ModelLoader m_modelLoader;
+        ModelData m_modelData{};
+        std::future<bool> m_sceneLoading;
         PathTracer m_pathTracer;
+        RenderFarm m_renderFarm;
+        NOX::ApplicationCommandLineArguments m_arguments{};
     };
 
 } // namespace NOXPT
@@ -0,0 +1,85 @@
+#include "benchmark.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+namespace NOXPT {
+
+    namespace {
+
+        constexpr const char *s_benchmarkArgument = "--benchmark";
+        constexpr const char *s_stackTraversalName = "stack";
+        constexpr const char *s_stacklessTraversalName = "stackless";
+
+        std::string getTraversalName(const NOX::ApplicationCommandLineArguments &arguments) {
+            return arguments.count >= 3 && std::string(arguments[2]) == s_stacklessTraversalName ? s_stacklessTraversalName : s_stackTraversalName;
+        }
+
+    } // namespace
+
+    Benchmark::Benchmark(PathTracer &pathTracer, Scene &scene) : m_pathTracer(&pathTracer),
+                                                                 m_scene(&scene) {}
+
+    bool Benchmark::isBenchmark(const NOX::ApplicationCommandLineArguments &arguments) {
+        return arguments.count >= 2 && std::string(arguments[1]) == s_benchmarkArgument;
+    }
+
+    KernelProgramSettings Benchmark::getKernelProgramSettings(const NOX::ApplicationCommandLineArguments &arguments) {
+        if (!isBenchmark(arguments)) {
+            return {};
+        }
+
+        return {"assets/kernels/benchmark_" + getTraversalName(arguments) + ".cl", true};
+    }
+
+    void Benchmark::run(const NOX::ApplicationCommandLineArguments &arguments, const BenchmarkSettings &settings) {
+        if (m_scene->getInstances().empty()) {
+            std::cout << "Benchmark: the scene is empty" << std::endl;
+            return;
+        }
+
+        const auto meshIndex = m_scene->getInstances().front().meshIndex;
+        m_bounds = m_scene->getMeshes()[meshIndex].bounds;
+
+        std::ofstream output(settings.outputPath, std::ios::out | std::ios::app);
+        const auto traversalName = getTraversalName(arguments);
+        for (const auto instancesCount : settings.instancesCounts) {
+            setInstancesCount(meshIndex, instancesCount);
+            for (const auto layout : {BVHNodeLayout::DEPTH_FIRST, BVHNodeLayout::TREELET}) {
+                m_pathTracer->setNodeLayout(layout);
+                const auto statistics = m_pathTracer->benchmark(settings.warmupFramesCount, settings.framesCount);
+
+                std::ostringstream result{};
+                result << traversalName << ", " << (layout == BVHNodeLayout::TREELET ? "treelet" : "depth-first") << ", " << instancesCount << " instances: "
+                       << statistics.frameTime * 1000.0f << " ms, " << statistics.megaraysPerSecond << " Mrays/s";
+                std::cout << "Benchmark: " << result.str() << std::endl;
+                output << result.str() << std::endl;
+            }
+        }
+
+        std::cout << "Benchmark: results appended to " << settings.outputPath << std::endl;
+    }
+
+    void Benchmark::setInstancesCount(uint32_t meshIndex, uint32_t instancesCount) {
+        while (!m_scene->getInstances().empty()) {
+            m_scene->removeInstance(static_cast<uint32_t>(m_scene->getInstances().size() - 1u));
+        }
+
+        const auto gridSize = std::max(static_cast<uint32_t>(std::ceil(std::cbrt(static_cast<float>(instancesCount)))), 1u);
+        const auto cellSize = (m_bounds.maximum() - m_bounds.minimum()) / static_cast<float>(gridSize);
+        const auto center = m_bounds.centroid();
+        for (auto i = 0u; i < instancesCount; i++) {
+            const auto cell = glm::vec3(i % gridSize, (i / gridSize) % gridSize, i / (gridSize * gridSize));
+            auto transform = glm::translate(glm::mat4{1.0f}, m_bounds.minimum() + (cell + glm::vec3(0.5f)) * cellSize);
+            transform = glm::scale(transform, glm::vec3(1.0f / static_cast<float>(gridSize)));
+            transform = glm::translate(transform, -center);
+            m_scene->addInstance(meshIndex, transform);
+        }
+    }
+
+} // namespace NOXPT
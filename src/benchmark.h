@@ -0,0 +1,38 @@
+#pragma once
+
+#include "path_tracer.h"
+#include "scene.h"
+
+#include <nox/application.h>
+
+#include <string>
+#include <vector>
+
+namespace NOXPT {
+
+    struct BenchmarkSettings {
+        std::vector<uint32_t> instancesCounts{1u, 8u, 64u};
+        uint32_t warmupFramesCount{4u};
+        uint32_t framesCount{16u};
+        std::string outputPath{"benchmark.txt"};
+    };
+
+    class Benchmark {
+      public:
+        Benchmark(PathTracer &pathTracer, Scene &scene);
+
+        static bool isBenchmark(const NOX::ApplicationCommandLineArguments &arguments);
+        static KernelProgramSettings getKernelProgramSettings(const NOX::ApplicationCommandLineArguments &arguments);
+
+        void run(const NOX::ApplicationCommandLineArguments &arguments, const BenchmarkSettings &settings = {});
+
+      private:
+        void setInstancesCount(uint32_t meshIndex, uint32_t instancesCount);
+
+      private:
+        PathTracer *m_pathTracer{nullptr};
+        Scene *m_scene{nullptr};
+        NOX::BoundingBox m_bounds{};
+    };
+
+} // namespace NOXPT
@@ -3,18 +3,59 @@
 #include <nox/maths/bounding_box.h>
 
 #include <algorithm>
+#include <functional>
+#include <limits>
+#include <queue>
+#include <utility>
 
 namespace NOXPT {
 
-    struct BVHTriangleInfo {
-        BVHTriangleInfo() = default;
-        BVHTriangleInfo(const size_t index, const KernelTypes::Triangle &triangle) : index(index),
-                                                                                     bounds({std::min({triangle.v0.position.x, triangle.v1.position.x, triangle.v2.position.x}),
-                                                                                             std::min({triangle.v0.position.y, triangle.v1.position.y, triangle.v2.position.y}),
-                                                                                             std::min({triangle.v0.position.z, triangle.v1.position.z, triangle.v2.position.z})},
-                                                                                            {std::max({triangle.v0.position.x, triangle.v1.position.x, triangle.v2.position.x}),
-                                                                                             std::max({triangle.v0.position.y, triangle.v1.position.y, triangle.v2.position.y}),
-                                                                                             std::max({triangle.v0.position.z, triangle.v1.position.z, triangle.v2.position.z})}) {}
+    namespace {
+
+        constexpr uint32_t s_invalidNodeIndex = 0xFFFFFFFFu;
+        constexpr uint32_t s_childTriangleCountBits = 16u;
+        constexpr uint32_t s_childTriangleCountMask = 0xFFFFu;
+        constexpr uint32_t s_treeletNodesCount = 4096u / sizeof(KernelTypes::BVHNode);
+        constexpr float s_minOptimizationPassGain = 0.001f;
+
+        float surfaceArea(const cl_float4 &boundsXY, const float minimumZ, const float maximumZ) {
+            const auto x = boundsXY.s[1] - boundsXY.s[0];
+            const auto y = boundsXY.s[3] - boundsXY.s[2];
+            const auto z = maximumZ - minimumZ;
+            return 2.0f * (x * y + y * z + z * x);
+        }
+
+        void setChild(KernelTypes::BVHNode &node, const bool isRightChild, const NOX::BoundingBox &bounds, const uint32_t index, const uint32_t triangleCount) {
+            const auto &minimum = bounds.minimum();
+            const auto &maximum = bounds.maximum();
+            if (isRightChild) {
+                node.rightBoundsXY = {minimum.x, maximum.x, minimum.y, maximum.y};
+                node.childrenBoundsZ.s[2] = minimum.z;
+                node.childrenBoundsZ.s[3] = maximum.z;
+                node.rightIndex = index;
+                node.childrenTriangleCounts |= triangleCount << s_childTriangleCountBits;
+            } else {
+                node.leftBoundsXY = {minimum.x, maximum.x, minimum.y, maximum.y};
+                node.childrenBoundsZ.s[0] = minimum.z;
+                node.childrenBoundsZ.s[1] = maximum.z;
+                node.leftIndex = index;
+                node.childrenTriangleCounts |= triangleCount;
+            }
+        }
+
+    } // namespace
+
+    struct BVHPrimitiveInfo {
+        BVHPrimitiveInfo() = default;
+        BVHPrimitiveInfo(const size_t index, const NOX::BoundingBox &bounds) : index(index),
+                                                                               bounds(bounds) {}
+        BVHPrimitiveInfo(const size_t index, const KernelTypes::Triangle &triangle) : index(index),
+                                                                                      bounds({std::min({triangle.v0.position.x, triangle.v1.position.x, triangle.v2.position.x}),
+                                                                                              std::min({triangle.v0.position.y, triangle.v1.position.y, triangle.v2.position.y}),
+                                                                                              std::min({triangle.v0.position.z, triangle.v1.position.z, triangle.v2.position.z})},
+                                                                                             {std::max({triangle.v0.position.x, triangle.v1.position.x, triangle.v2.position.x}),
+                                                                                              std::max({triangle.v0.position.y, triangle.v1.position.y, triangle.v2.position.y}),
+                                                                                              std::max({triangle.v0.position.z, triangle.v1.position.z, triangle.v2.position.z})}) {}
 
         size_t index{};
         NOX::BoundingBox bounds{};
@@ -31,10 +72,30 @@ namespace NOXPT {
             bounds = {left->bounds, right->bounds};
             leftChild = left;
             rightChild = right;
+            left->parent = this;
+            right->parent = this;
             splitAxis = axis;
         }
 
+        bool isLeaf() const {
+            return triangleCount > 0u;
+        }
+
+        BVHNode *sibling() const {
+            return parent->leftChild == this ? parent->rightChild : parent->leftChild;
+        }
+
+        void replaceChild(BVHNode *child, BVHNode *newChild) {
+            if (leftChild == child) {
+                leftChild = newChild;
+            } else {
+                rightChild = newChild;
+            }
+            newChild->parent = this;
+        }
+
         NOX::BoundingBox bounds{};
+        BVHNode *parent{nullptr};
         BVHNode *leftChild{nullptr};
         BVHNode *rightChild{nullptr};
         uint32_t firstTriangleOffset{};
@@ -47,61 +108,107 @@ namespace NOXPT {
         NOX::BoundingBox bounds{};
     };
 
-    void BVH::build(const std::vector<KernelTypes::Triangle> &triangles) {
-        m_orderedTriangles.reserve(triangles.size());
-        std::vector<BVHTriangleInfo> trianglesInfo(triangles.size());
-        for (size_t i = 0; i < triangles.size(); i++) {
-            trianglesInfo[i] = {i, triangles[i]};
+    uint32_t BVH::build(const KernelTypes::Triangle *triangles, const uint32_t *triangleIndices, const uint32_t trianglesCount, const NodesAllocator &allocateNodes,
+                        KernelTypes::Triangle *orderedTriangles) {
+        std::vector<BVHPrimitiveInfo> primitivesInfo(trianglesCount);
+        for (uint32_t i = 0u; i < trianglesCount; i++) {
+            primitivesInfo[i] = {i, triangles[triangleIndices[i]]};
+        }
+
+        const auto nodesCount = build(primitivesInfo, 4u, allocateNodes);
+        for (size_t i = 0; i < m_primitiveIndices.size(); i++) {
+            orderedTriangles[i] = triangles[triangleIndices[m_primitiveIndices[i]]];
+        }
+
+        return nodesCount;
+    }
+
+    void BVH::build(const std::vector<NOX::BoundingBox> &bounds, const uint32_t maxPrimitivesInNode) {
+        std::vector<BVHPrimitiveInfo> primitivesInfo(bounds.size());
+        for (size_t i = 0; i < bounds.size(); i++) {
+            primitivesInfo[i] = {i, bounds[i]};
+        }
+
+        m_nodes.clear();
+        build(primitivesInfo, maxPrimitivesInNode, [this](size_t nodesCount) {
+            m_nodes.resize(nodesCount);
+            return m_nodes.data();
+        });
+    }
+
+    uint32_t BVH::build(std::vector<BVHPrimitiveInfo> &primitivesInfo, const uint32_t maxPrimitivesInNode, const NodesAllocator &allocateNodes) {
+        m_maxPrimitivesInNode = maxPrimitivesInNode;
+        m_primitiveIndices.clear();
+        m_primitiveIndices.reserve(primitivesInfo.size());
+        m_leavesCount = 0u;
+        m_bounds = {};
+        if (primitivesInfo.empty()) {
+            return 0u;
         }
 
         uint32_t totalNodes = 0;
-        BVHNode *root = subdivide(triangles, trianglesInfo, 0, static_cast<uint32_t>(triangles.size()), totalNodes);
+        BVHNode *root = subdivide(primitivesInfo, 0, static_cast<uint32_t>(primitivesInfo.size()), totalNodes);
+
+        m_initialCost = computeCost(root) / root->bounds.surfaceArea();
+        m_cost = m_initialCost;
+        if (m_optimizationBudget.count() > 0) {
+            optimize(root);
+        }
 
-        uint32_t offset = 0;
-        m_nodes.resize(totalNodes);
-        buildNodesBuffer(root, offset);
+        m_bounds = root->bounds;
+        const auto nodesCount = root->isLeaf() ? 1u : totalNodes - m_leavesCount;
+        m_outputNodes = allocateNodes(nodesCount);
+        m_outputNodesCount = 0u;
+        buildNodesBuffer(root, s_invalidNodeIndex);
         cleanupNodes(root);
+
+        if (m_nodeLayout == BVHNodeLayout::TREELET) {
+            reorderNodes();
+        }
+
+        m_outputNodes = nullptr;
+        return nodesCount;
     }
 
-    BVHNode *BVH::subdivide(const std::vector<KernelTypes::Triangle> &triangles, std::vector<BVHTriangleInfo> &trianglesInfo, const uint32_t start, const uint32_t end, uint32_t &totalNodes) {
+    BVHNode *BVH::createLeaf(BVHNode *node, std::vector<BVHPrimitiveInfo> &primitivesInfo, const uint32_t start, const uint32_t end, const NOX::BoundingBox &bounds) {
+        auto offset = m_primitiveIndices.size();
+        m_leavesCount++;
+        for (auto i = start; i < end; i++) {
+            m_primitiveIndices.push_back(static_cast<uint32_t>(primitivesInfo[i].index));
+        }
+
+        node->initLeaf(static_cast<uint32_t>(offset), end - start, bounds);
+        return node;
+    }
+
+    BVHNode *BVH::subdivide(std::vector<BVHPrimitiveInfo> &primitivesInfo, const uint32_t start, const uint32_t end, uint32_t &totalNodes) {
         BVHNode *node = new BVHNode();
         totalNodes++;
 
         NOX::BoundingBox bounds{};
         for (auto i = start; i < end; i++) {
-            bounds.grow(trianglesInfo[i].bounds);
+            bounds.grow(primitivesInfo[i].bounds);
         }
 
-        uint32_t trianglesCount = end - start;
-        if (trianglesCount == 1u) {
-            auto offset = m_orderedTriangles.size();
-            for (auto i = start; i < end; i++) {
-                m_orderedTriangles.push_back(triangles[trianglesInfo[i].index]);
-            }
-
-            node->initLeaf(static_cast<uint32_t>(offset), trianglesCount, bounds);
-            return node;
+        uint32_t primitivesCount = end - start;
+        if (primitivesCount == 1u) {
+            return createLeaf(node, primitivesInfo, start, end, bounds);
         } else {
             NOX::BoundingBox centroidBounds{};
             for (auto i = start; i < end; i++) {
-                centroidBounds.grow(trianglesInfo[i].bounds.centroid());
+                centroidBounds.grow(primitivesInfo[i].bounds.centroid());
             }
 
             auto splitAxis = centroidBounds.maximumExtentAxis();
             auto mid = (start + end) / 2;
             if (centroidBounds.minimum()[splitAxis] == centroidBounds.maximum()[splitAxis]) {
-                auto offset = m_orderedTriangles.size();
-                for (auto i = start; i < end; i++) {
-                    m_orderedTriangles.push_back(triangles[trianglesInfo[i].index]);
+                if (primitivesCount <= m_maxPrimitivesInNode) {
+                    return createLeaf(node, primitivesInfo, start, end, bounds);
                 }
-
-                node->initLeaf(static_cast<uint32_t>(offset), trianglesCount, bounds);
-                return node;
             } else {
-                if (trianglesCount <= 2u) {
-                    auto mid = (start + end) / 2;
-                    std::nth_element(&trianglesInfo[start], &trianglesInfo[mid], &trianglesInfo[end - 1] + 1,
-                                     [splitAxis](const BVHTriangleInfo &a, const BVHTriangleInfo &b) {
+                if (primitivesCount <= 2u) {
+                    std::nth_element(&primitivesInfo[start], &primitivesInfo[mid], &primitivesInfo[end - 1] + 1,
+                                     [splitAxis](const BVHPrimitiveInfo &a, const BVHPrimitiveInfo &b) {
                                          return a.bounds.centroid()[splitAxis] < b.bounds.centroid()[splitAxis];
                                      });
                 } else {
@@ -109,13 +216,13 @@ namespace NOXPT {
                     BucketInfo buckets[bucketsCount]{};
 
                     for (auto i = start; i < end; i++) {
-                        auto b = bucketsCount * static_cast<uint32_t>(centroidBounds.offset(trianglesInfo[i].bounds.centroid())[splitAxis]);
+                        auto b = bucketsCount * static_cast<uint32_t>(centroidBounds.offset(primitivesInfo[i].bounds.centroid())[splitAxis]);
                         if (b == bucketsCount) {
                             b = bucketsCount - 1u;
                         }
 
                         buckets[b].count++;
-                        buckets[b].bounds.grow(trianglesInfo[i].bounds);
+                        buckets[b].bounds.grow(primitivesInfo[i].bounds);
                     }
 
                     float cost[bucketsCount - 1];
@@ -145,11 +252,10 @@ namespace NOXPT {
                         }
                     }
 
-                    constexpr uint32_t maxPrimsInNode = 4u;
-                    float leafCost = static_cast<float>(trianglesCount);
-                    if (trianglesCount > maxPrimsInNode || minCost < leafCost) {
-                        auto *pMid = std::partition(&trianglesInfo[start], &trianglesInfo[end - 1] + 1,
-                                                    [=](const BVHTriangleInfo &pi) {
+                    float leafCost = static_cast<float>(primitivesCount);
+                    if (primitivesCount > m_maxPrimitivesInNode || minCost < leafCost) {
+                        auto *pMid = std::partition(&primitivesInfo[start], &primitivesInfo[end - 1] + 1,
+                                                    [=](const BVHPrimitiveInfo &pi) {
                                                         auto b = static_cast<uint32_t>(bucketsCount * centroidBounds.offset(pi.bounds.centroid())[splitAxis]);
                                                         if (b == bucketsCount) {
                                                             b = bucketsCount - 1;
@@ -157,44 +263,213 @@ namespace NOXPT {
 
                                                         return b <= minCostSplitBucket;
                                                     });
-                        mid = static_cast<uint32_t>(pMid - &trianglesInfo[0]);
+                        mid = static_cast<uint32_t>(pMid - &primitivesInfo[0]);
                     } else {
-                        auto offset = m_orderedTriangles.size();
-                        for (auto i = start; i < end; i++) {
-                            m_orderedTriangles.push_back(triangles[trianglesInfo[i].index]);
-                        }
-
-                        node->initLeaf(static_cast<uint32_t>(offset), trianglesCount, bounds);
-                        return node;
+                        return createLeaf(node, primitivesInfo, start, end, bounds);
                     }
                 }
-
-                node->initNode(splitAxis, subdivide(triangles, trianglesInfo, start, mid, totalNodes), subdivide(triangles, trianglesInfo, mid, end, totalNodes));
             }
+
+            node->initNode(splitAxis, subdivide(primitivesInfo, start, mid, totalNodes), subdivide(primitivesInfo, mid, end, totalNodes));
         }
 
         return node;
     }
 
-    uint32_t BVH::buildNodesBuffer(BVHNode *node, uint32_t &offset) {
-        auto &newNode = m_nodes[offset];
-        const auto &boundingBoxMinimum = node->bounds.minimum();
-        const auto &boundingBoxMaximum = node->bounds.maximum();
-        newNode.bounds = {{boundingBoxMinimum.x, boundingBoxMinimum.y, boundingBoxMinimum.z},
-                          {boundingBoxMaximum.x, boundingBoxMaximum.y, boundingBoxMaximum.z}};
+    void BVH::optimize(BVHNode *&root) {
+        const auto deadline = std::chrono::steady_clock::now() + m_optimizationBudget;
 
-        auto tempOffset = offset++;
-        if (node->triangleCount > 0u) {
-            newNode.triangleCount = node->triangleCount;
-            newNode.firstTriangleOffset = node->firstTriangleOffset;
+        std::vector<BVHNode *> nodes{root};
+        for (size_t i = 0; i < nodes.size(); i++) {
+            if (!nodes[i]->isLeaf()) {
+                nodes.push_back(nodes[i]->leftChild);
+                nodes.push_back(nodes[i]->rightChild);
+            }
+        }
+
+        auto cost = computeCost(root);
+        auto isTimeExceeded = false;
+        while (!isTimeExceeded) {
+            std::sort(nodes.begin(), nodes.end(), [](const BVHNode *a, const BVHNode *b) {
+                return a->bounds.surfaceArea() > b->bounds.surfaceArea();
+            });
+
+            auto passGain = 0.0f;
+            for (auto *node : nodes) {
+                if (std::chrono::steady_clock::now() >= deadline) {
+                    isTimeExceeded = true;
+                    break;
+                }
+
+                if (node->parent != nullptr && node->parent->parent != nullptr) {
+                    passGain += reinsert(node, root);
+                }
+            }
+
+            cost -= passGain;
+            if (passGain <= s_minOptimizationPassGain * cost) {
+                break;
+            }
+        }
+
+        m_cost = computeCost(root) / root->bounds.surfaceArea();
+    }
+
+    float BVH::reinsert(BVHNode *node, BVHNode *&root) {
+        auto *parent = node->parent;
+        auto *sibling = node->sibling();
+        auto *grandparent = parent->parent;
+        grandparent->replaceChild(parent, sibling);
+
+        auto removalGain = parent->bounds.surfaceArea();
+        for (auto *ancestor = grandparent; ancestor != nullptr; ancestor = ancestor->parent) {
+            const auto previousArea = ancestor->bounds.surfaceArea();
+            ancestor->bounds = {ancestor->leftChild->bounds, ancestor->rightChild->bounds};
+            removalGain += previousArea - ancestor->bounds.surfaceArea();
+        }
+
+        const auto nodeArea = node->bounds.surfaceArea();
+        auto *bestSibling = root;
+        auto bestCost = NOX::BoundingBox(root->bounds, node->bounds).surfaceArea();
+
+        using Candidate = std::pair<float, BVHNode *>;
+        std::priority_queue<Candidate, std::vector<Candidate>, std::greater<Candidate>> candidates{};
+        candidates.push({0.0f, root});
+        while (!candidates.empty()) {
+            const auto [inducedCost, candidate] = candidates.top();
+            candidates.pop();
+            if (inducedCost + nodeArea >= bestCost) {
+                break;
+            }
+
+            const auto mergedArea = NOX::BoundingBox(candidate->bounds, node->bounds).surfaceArea();
+            if (inducedCost + mergedArea < bestCost) {
+                bestSibling = candidate;
+                bestCost = inducedCost + mergedArea;
+            }
+
+            const auto childInducedCost = inducedCost + mergedArea - candidate->bounds.surfaceArea();
+            if (!candidate->isLeaf() && childInducedCost + nodeArea < bestCost) {
+                candidates.push({childInducedCost, candidate->leftChild});
+                candidates.push({childInducedCost, candidate->rightChild});
+            }
+        }
+
+        auto *bestParent = bestSibling->parent;
+        if (bestParent != nullptr) {
+            bestParent->replaceChild(bestSibling, parent);
         } else {
-            newNode.splitAxis = node->splitAxis;
-            newNode.triangleCount = 0u;
-            buildNodesBuffer(node->leftChild, offset);
-            newNode.firstTriangleOffset = buildNodesBuffer(node->rightChild, offset);
+            parent->parent = nullptr;
+            root = parent;
+        }
+        parent->leftChild = bestSibling;
+        parent->rightChild = node;
+        bestSibling->parent = parent;
+        node->parent = parent;
+
+        for (auto *ancestor = parent; ancestor != nullptr; ancestor = ancestor->parent) {
+            ancestor->bounds = {ancestor->leftChild->bounds, ancestor->rightChild->bounds};
+        }
+
+        return removalGain - bestCost;
+    }
+
+    float BVH::computeCost(const BVHNode *node) const {
+        if (node->isLeaf()) {
+            return node->bounds.surfaceArea() * static_cast<float>(node->triangleCount);
+        }
+
+        return node->bounds.surfaceArea() + computeCost(node->leftChild) + computeCost(node->rightChild);
+    }
+
+    uint32_t BVH::buildNodesBuffer(const BVHNode *node, const uint32_t parentIndex) {
+        const auto index = m_outputNodesCount++;
+        auto &outputNode = m_outputNodes[index];
+        outputNode = {};
+        outputNode.parentIndex = parentIndex;
+
+        if (node->triangleCount > 0u) {
+            setChild(outputNode, false, node->bounds, node->firstTriangleOffset, node->triangleCount);
+            outputNode.rightIndex = s_invalidNodeIndex;
+            return index;
+        }
+
+        const auto *leftChild = node->leftChild;
+        const auto *rightChild = node->rightChild;
+        const auto leftIndex = leftChild->triangleCount > 0u ? leftChild->firstTriangleOffset : buildNodesBuffer(leftChild, index);
+        const auto rightIndex = rightChild->triangleCount > 0u ? rightChild->firstTriangleOffset : buildNodesBuffer(rightChild, index);
+        setChild(m_outputNodes[index], false, leftChild->bounds, leftIndex, leftChild->triangleCount);
+        setChild(m_outputNodes[index], true, rightChild->bounds, rightIndex, rightChild->triangleCount);
+
+        return index;
+    }
+
+    void BVH::reorderNodes() {
+        const std::vector<KernelTypes::BVHNode> sourceNodes(m_outputNodes, m_outputNodes + m_outputNodesCount);
+        std::vector<uint32_t> order{};
+        std::vector<uint32_t> newIndices(sourceNodes.size(), s_invalidNodeIndex);
+        order.reserve(sourceNodes.size());
+
+        std::vector<uint32_t> treeletRoots{0u};
+        while (!treeletRoots.empty()) {
+            const auto treeletRoot = treeletRoots.back();
+            treeletRoots.pop_back();
+
+            std::priority_queue<std::pair<float, uint32_t>> frontier{};
+            frontier.push({std::numeric_limits<float>::max(), treeletRoot});
+            for (auto treeletNodesCount = 0u; !frontier.empty() && treeletNodesCount < s_treeletNodesCount; treeletNodesCount++) {
+                const auto index = frontier.top().second;
+                frontier.pop();
+
+                newIndices[index] = static_cast<uint32_t>(order.size());
+                order.push_back(index);
+
+                const auto &node = sourceNodes[index];
+                if ((node.childrenTriangleCounts & s_childTriangleCountMask) == 0u) {
+                    frontier.push({surfaceArea(node.leftBoundsXY, node.childrenBoundsZ.s[0], node.childrenBoundsZ.s[1]), node.leftIndex});
+                }
+                if ((node.childrenTriangleCounts >> s_childTriangleCountBits) == 0u && node.rightIndex != s_invalidNodeIndex) {
+                    frontier.push({surfaceArea(node.rightBoundsXY, node.childrenBoundsZ.s[2], node.childrenBoundsZ.s[3]), node.rightIndex});
+                }
+            }
+
+            const auto firstRoot = treeletRoots.size();
+            for (; !frontier.empty(); frontier.pop()) {
+                treeletRoots.push_back(frontier.top().second);
+            }
+            std::reverse(treeletRoots.begin() + static_cast<std::ptrdiff_t>(firstRoot), treeletRoots.end());
+        }
+
+        std::vector<uint32_t> primitiveIndices{};
+        primitiveIndices.reserve(m_primitiveIndices.size());
+
+        const auto remapChild = [&](uint32_t &childIndex, const uint32_t triangleCount) {
+            if (childIndex == s_invalidNodeIndex) {
+                return;
+            }
+
+            if (triangleCount == 0u) {
+                childIndex = newIndices[childIndex];
+                return;
+            }
+
+            const auto firstPrimitive = m_primitiveIndices.begin() + childIndex;
+            childIndex = static_cast<uint32_t>(primitiveIndices.size());
+            primitiveIndices.insert(primitiveIndices.end(), firstPrimitive, firstPrimitive + triangleCount);
+        };
+
+        for (size_t i = 0; i < order.size(); i++) {
+            auto node = sourceNodes[order[i]];
+            if (node.parentIndex != s_invalidNodeIndex) {
+                node.parentIndex = newIndices[node.parentIndex];
+            }
+
+            remapChild(node.leftIndex, node.childrenTriangleCounts & s_childTriangleCountMask);
+            remapChild(node.rightIndex, node.childrenTriangleCounts >> s_childTriangleCountBits);
+            m_outputNodes[i] = node;
         }
 
-        return tempOffset;
+        m_primitiveIndices = std::move(primitiveIndices);
     }
 
     void BVH::cleanupNodes(BVHNode *node) {
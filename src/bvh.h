@@ -2,28 +2,62 @@
 
 #include "kernel_types.h"
 
+#include <nox/maths/bounding_box.h>
+
+#include <chrono>
+#include <functional>
 #include <vector>
 
 namespace NOXPT {
 
     struct BVHNode;
-    struct BVHTriangleInfo;
+    struct BVHPrimitiveInfo;
+
+    enum class BVHNodeLayout {
+        DEPTH_FIRST,
+        TREELET
+    };
 
     class BVH {
       public:
-        const std::vector<KernelTypes::BVHNode> &getBvhNodes() const { return m_nodes; }
-        const std::vector<KernelTypes::Triangle> &getOrderedTriangles() const { return m_orderedTriangles; }
+        using NodesAllocator = std::function<KernelTypes::BVHNode *(size_t nodesCount)>;
 
-        void build(const std::vector<KernelTypes::Triangle> &triangles);
+        const std::vector<KernelTypes::BVHNode> &getBvhNodes() const { return m_nodes; }
+        const std::vector<uint32_t> &getPrimitiveIndices() const { return m_primitiveIndices; }
+        const NOX::BoundingBox &getBounds() const { return m_bounds; }
+        BVHNodeLayout getNodeLayout() const { return m_nodeLayout; }
+        void setNodeLayout(const BVHNodeLayout layout) { m_nodeLayout = layout; }
+        void setOptimizationBudget(const std::chrono::milliseconds budget) { m_optimizationBudget = budget; }
+        float getInitialCost() const { return m_initialCost; }
+        float getCost() const { return m_cost; }
+
+        uint32_t build(const KernelTypes::Triangle *triangles, const uint32_t *triangleIndices, const uint32_t trianglesCount, const NodesAllocator &allocateNodes,
+                       KernelTypes::Triangle *orderedTriangles);
+        void build(const std::vector<NOX::BoundingBox> &bounds, const uint32_t maxPrimitivesInNode);
 
       private:
-        BVHNode *subdivide(const std::vector<KernelTypes::Triangle> &triangles, std::vector<BVHTriangleInfo> &trianglesInfo, const uint32_t start, const uint32_t end, uint32_t &totalNodes);
-        uint32_t buildNodesBuffer(BVHNode *node, uint32_t &offset);
+        uint32_t build(std::vector<BVHPrimitiveInfo> &primitivesInfo, const uint32_t maxPrimitivesInNode, const NodesAllocator &allocateNodes);
+        BVHNode *createLeaf(BVHNode *node, std::vector<BVHPrimitiveInfo> &primitivesInfo, const uint32_t start, const uint32_t end, const NOX::BoundingBox &bounds);
+        BVHNode *subdivide(std::vector<BVHPrimitiveInfo> &primitivesInfo, const uint32_t start, const uint32_t end, uint32_t &totalNodes);
+        void optimize(BVHNode *&root);
+        float reinsert(BVHNode *node, BVHNode *&root);
+        float computeCost(const BVHNode *node) const;
+        uint32_t buildNodesBuffer(const BVHNode *node, const uint32_t parentIndex);
+        void reorderNodes();
         void cleanupNodes(BVHNode *node);
 
       private:
         std::vector<KernelTypes::BVHNode> m_nodes{};
-        std::vector<KernelTypes::Triangle> m_orderedTriangles{};
+        KernelTypes::BVHNode *m_outputNodes{nullptr};
+        uint32_t m_outputNodesCount{0u};
+        uint32_t m_leavesCount{0u};
+        std::vector<uint32_t> m_primitiveIndices{};
+        NOX::BoundingBox m_bounds{};
+        uint32_t m_maxPrimitivesInNode{4u};
+        BVHNodeLayout m_nodeLayout{BVHNodeLayout::DEPTH_FIRST};
+        std::chrono::milliseconds m_optimizationBudget{0};
+        float m_initialCost{0.0f};
+        float m_cost{0.0f};
     };
 
 } // namespace NOXPT
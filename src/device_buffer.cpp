@@ -0,0 +1,63 @@
+#include "device_buffer.h"
+
+#include <algorithm>
+
+namespace NOXPT {
+
+    namespace {
+
+        constexpr size_t s_minimumCapacity = 256u;
+
+    } // namespace
+
+    bool DeviceBuffer::reserve(size_t size) {
+        if (m_buffer != nullptr && m_hostPointer == nullptr && size <= m_capacity) {
+            return false;
+        }
+
+        m_buffer.reset();
+
+        auto capacity = std::max({size, m_capacity * 2u, s_minimumCapacity});
+        if (!m_memoryTracker->canAllocate(capacity)) {
+            capacity = std::max(size, s_minimumCapacity);
+        }
+
+        m_buffer = m_memoryTracker->createBuffer(m_category, m_usage, capacity);
+        m_capacity = capacity;
+        m_hostPointer = nullptr;
+        return true;
+    }
+
+    bool DeviceBuffer::upload(const void *data, size_t size, size_t dirtyOffset, size_t dirtySize) {
+        const auto isReallocated = (m_isZeroCopy && size > 0u) ? wrap(data, size) : reserve(size);
+        if (m_hostPointer != nullptr) {
+            return isReallocated;
+        }
+
+        if (isReallocated) {
+            dirtyOffset = 0u;
+            dirtySize = size;
+        }
+
+        dirtyOffset = std::min(dirtyOffset, size);
+        dirtySize = std::min(dirtySize, size - dirtyOffset);
+        if (dirtySize > 0u) {
+            NOX::Compute::enqueueWriteBuffer(*m_buffer, dirtyOffset, dirtySize, static_cast<const uint8_t *>(data) + dirtyOffset);
+        }
+
+        return isReallocated;
+    }
+
+    bool DeviceBuffer::wrap(const void *data, size_t size) {
+        if (m_buffer != nullptr && m_hostPointer == data && m_capacity == size) {
+            return false;
+        }
+
+        m_buffer.reset();
+        m_buffer = m_memoryTracker->createBuffer(m_category, m_usage | NOX::MemoryUsage::USE_HOST_PTR, size, data);
+        m_capacity = size;
+        m_hostPointer = data;
+        return true;
+    }
+
+} // namespace NOXPT
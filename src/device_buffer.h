@@ -0,0 +1,37 @@
+#pragma once
+
+#include "device_memory_tracker.h"
+
+#include <nox/compute/compute.h>
+#include <nox/compute/compute_buffer.h>
+
+namespace NOXPT {
+
+    class DeviceBuffer {
+      public:
+        DeviceBuffer(DeviceMemoryTracker &memoryTracker, DeviceMemoryCategory category, NOX::MemoryUsage usage = NOX::MemoryUsage::READ_ONLY) : m_memoryTracker(&memoryTracker),
+                                                                                                                                                 m_category(category),
+                                                                                                                                                 m_usage(usage) {}
+
+        const NOX::ComputeBuffer &operator*() const { return *m_buffer; }
+        size_t getCapacity() const { return m_capacity; }
+        bool isZeroCopy() const { return m_isZeroCopy; }
+        void setZeroCopy(bool isZeroCopy) { m_isZeroCopy = isZeroCopy; }
+
+        bool reserve(size_t size);
+        bool upload(const void *data, size_t size, size_t dirtyOffset, size_t dirtySize);
+
+      private:
+        bool wrap(const void *data, size_t size);
+
+      private:
+        DeviceMemoryTracker *m_memoryTracker{nullptr};
+        DeviceMemoryCategory m_category{};
+        std::shared_ptr<NOX::ComputeBuffer> m_buffer{nullptr};
+        NOX::MemoryUsage m_usage{};
+        size_t m_capacity{0u};
+        const void *m_hostPointer{nullptr};
+        bool m_isZeroCopy{false};
+    };
+
+} // namespace NOXPT
@@ -0,0 +1,82 @@
+#include "device_memory_tracker.h"
+
+#include <algorithm>
+#include <iostream>
+
+namespace NOXPT {
+
+    namespace {
+
+        constexpr float s_budgetFraction = 0.9f;
+        constexpr double s_bytesInMegabyte = 1024.0 * 1024.0;
+
+        constexpr const char *s_categoryNames[] = {"rays", "accumulation", "denoise", "bvh", "triangles", "lights", "materials"};
+
+        double toMegabytes(size_t size) {
+            return static_cast<double>(size) / s_bytesInMegabyte;
+        }
+
+        void grow(DeviceMemoryUsage &usage, size_t size) {
+            usage.current += size;
+            usage.peak = std::max(usage.peak, usage.current);
+        }
+
+    } // namespace
+
+    void DeviceMemoryTracker::initialize() {
+        cl_ulong globalMemorySize = 0u;
+        cl_ulong maxAllocationSize = 0u;
+        cl_bool isHostUnifiedMemory = CL_FALSE;
+        NOX::Compute::getDeviceInfo(CL_DEVICE_GLOBAL_MEM_SIZE, sizeof(cl_ulong), &globalMemorySize);
+        NOX::Compute::getDeviceInfo(CL_DEVICE_MAX_MEM_ALLOC_SIZE, sizeof(cl_ulong), &maxAllocationSize);
+        NOX::Compute::getDeviceInfo(CL_DEVICE_HOST_UNIFIED_MEMORY, sizeof(cl_bool), &isHostUnifiedMemory);
+
+        m_globalMemorySize = static_cast<size_t>(globalMemorySize);
+        m_maxAllocationSize = static_cast<size_t>(maxAllocationSize);
+        m_isHostUnifiedMemory = isHostUnifiedMemory == CL_TRUE;
+    }
+
+    size_t DeviceMemoryTracker::getBudget() const {
+        return static_cast<size_t>(static_cast<double>(m_globalMemorySize) * s_budgetFraction);
+    }
+
+    bool DeviceMemoryTracker::canAllocate(size_t size) const {
+        if (m_globalMemorySize == 0u) {
+            return true;
+        }
+
+        return (size <= m_maxAllocationSize) && (m_totalUsage.current + size <= getBudget());
+    }
+
+    std::shared_ptr<NOX::ComputeBuffer> DeviceMemoryTracker::createBuffer(DeviceMemoryCategory category, NOX::MemoryUsage usage, size_t size, const void *hostPointer) {
+        auto buffer = NOX::Compute::createBuffer(usage, size, hostPointer);
+        if (buffer == nullptr) {
+            return nullptr;
+        }
+
+        grow(m_usages[static_cast<size_t>(category)], size);
+        grow(m_totalUsage, size);
+
+        auto *computeBuffer = buffer.get();
+        return std::shared_ptr<NOX::ComputeBuffer>(computeBuffer, [this, category, size, buffer](NOX::ComputeBuffer *) mutable {
+            buffer.reset();
+            release(category, size);
+        });
+    }
+
+    void DeviceMemoryTracker::release(DeviceMemoryCategory category, size_t size) {
+        m_usages[static_cast<size_t>(category)].current -= size;
+        m_totalUsage.current -= size;
+    }
+
+    void DeviceMemoryTracker::log() const {
+        std::cout << "Device memory: " << toMegabytes(m_totalUsage.current) << " MiB (peak " << toMegabytes(m_totalUsage.peak) << " MiB)"
+                  << " of " << toMegabytes(getBudget()) << " MiB budget, max allocation " << toMegabytes(m_maxAllocationSize) << " MiB"
+                  << (m_isHostUnifiedMemory ? ", host unified memory" : "");
+        for (size_t i = 0; i < m_usages.size(); i++) {
+            std::cout << ", " << s_categoryNames[i] << " " << toMegabytes(m_usages[i].current) << "/" << toMegabytes(m_usages[i].peak);
+        }
+        std::cout << std::endl;
+    }
+
+} // namespace NOXPT
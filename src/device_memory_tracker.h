@@ -0,0 +1,52 @@
+#pragma once
+
+#include <nox/compute/compute.h>
+#include <nox/compute/compute_buffer.h>
+
+#include <array>
+#include <memory>
+
+namespace NOXPT {
+
+    enum class DeviceMemoryCategory : uint32_t {
+        RAYS = 0u,
+        ACCUMULATION,
+        DENOISE,
+        BVH,
+        TRIANGLES,
+        LIGHTS,
+        MATERIALS,
+        COUNT
+    };
+
+    struct DeviceMemoryUsage {
+        size_t current{0u};
+        size_t peak{0u};
+    };
+
+    class DeviceMemoryTracker {
+      public:
+        size_t getGlobalMemorySize() const { return m_globalMemorySize; }
+        size_t getMaxAllocationSize() const { return m_maxAllocationSize; }
+        bool isHostUnifiedMemory() const { return m_isHostUnifiedMemory; }
+        size_t getBudget() const;
+        const DeviceMemoryUsage &getUsage(DeviceMemoryCategory category) const { return m_usages[static_cast<size_t>(category)]; }
+        const DeviceMemoryUsage &getTotalUsage() const { return m_totalUsage; }
+
+        void initialize();
+        bool canAllocate(size_t size) const;
+        std::shared_ptr<NOX::ComputeBuffer> createBuffer(DeviceMemoryCategory category, NOX::MemoryUsage usage, size_t size, const void *hostPointer = nullptr);
+        void log() const;
+
+      private:
+        void release(DeviceMemoryCategory category, size_t size);
+
+      private:
+        std::array<DeviceMemoryUsage, static_cast<size_t>(DeviceMemoryCategory::COUNT)> m_usages{};
+        DeviceMemoryUsage m_totalUsage{};
+        size_t m_globalMemorySize{0u};
+        size_t m_maxAllocationSize{0u};
+        bool m_isHostUnifiedMemory{false};
+    };
+
+} // namespace NOXPT
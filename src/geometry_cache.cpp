@@ -0,0 +1,235 @@
+#include "geometry_cache.h"
+
+#include <nox/compute/compute.h>
+
+#include <algorithm>
+#include <iostream>
+#include <limits>
+#include <numeric>
+
+namespace NOXPT {
+
+    namespace {
+
+        constexpr uint32_t s_invalidChunkIndex = 0xFFFFFFFFu;
+        constexpr uint32_t s_invalidSlot = 0xFFFFFFFFu;
+        constexpr uint32_t s_maxChunkLoadsPerFrame = 8u;
+        constexpr size_t s_budgetDivisor = 2u;
+        constexpr cl_uint s_meshRequestFillPattern = 0u;
+        constexpr size_t s_emptyBufferSize = 256u;
+
+        std::shared_ptr<NOX::ComputeBuffer> wrapHostMemory(DeviceMemoryTracker &memoryTracker, DeviceMemoryCategory category, const void *data, size_t size) {
+            if (size == 0u) {
+                return memoryTracker.createBuffer(category, NOX::MemoryUsage::READ_ONLY, s_emptyBufferSize);
+            }
+
+            return memoryTracker.createBuffer(category, NOX::MemoryUsage::READ_ONLY | NOX::MemoryUsage::USE_HOST_PTR, size, data);
+        }
+
+    } // namespace
+
+    GeometryCache::GeometryCache(DeviceMemoryTracker &memoryTracker) : m_memoryTracker(&memoryTracker),
+                                                                       m_meshesBuffer(memoryTracker, DeviceMemoryCategory::BVH),
+                                                                       m_meshRequestsBuffer(memoryTracker, DeviceMemoryCategory::BVH, NOX::MemoryUsage::READ_WRITE) {}
+
+    size_t GeometryCache::getMemoryLimit() const {
+        if (m_memoryTracker->getGlobalMemorySize() == 0u) {
+            return std::numeric_limits<size_t>::max();
+        }
+
+        return m_memoryTracker->getBudget() / s_budgetDivisor;
+    }
+
+    bool GeometryCache::update(const AccelerationStructure &accelerationStructure, size_t firstChangedChunk) {
+        const auto chunksCount = accelerationStructure.getChunks().size();
+        auto isRebindRequired = false;
+        if (m_memoryTracker->isHostUnifiedMemory()) {
+            isRebindRequired = wrapChunks(accelerationStructure);
+        } else {
+            isRebindRequired = allocateSlots(accelerationStructure);
+            for (uint32_t slot = 0u; slot < m_slotChunks.size(); slot++) {
+                if (m_slotChunks[slot] != s_invalidChunkIndex && m_slotChunks[slot] >= firstChangedChunk) {
+                    evictSlot(slot);
+                }
+            }
+
+            m_meshes.resize(chunksCount, KernelTypes::Mesh{});
+            m_chunkLastUsedFrames.resize(chunksCount, m_frameIndex);
+            for (uint32_t chunkIndex = 0u; chunkIndex < chunksCount; chunkIndex++) {
+                if (m_meshes[chunkIndex].isResident != 0u) {
+                    continue;
+                }
+
+                const auto slot = findFreeSlot();
+                if (slot == s_invalidSlot) {
+                    break;
+                }
+
+                loadChunk(accelerationStructure, chunkIndex, slot);
+            }
+        }
+
+        m_meshRequests.assign(chunksCount, 0u);
+
+        const auto meshesSize = m_meshes.size() * sizeof(KernelTypes::Mesh);
+        const auto meshRequestsSize = m_meshRequests.size() * sizeof(cl_uint);
+        isRebindRequired |= m_meshesBuffer.upload(m_meshes.data(), meshesSize, 0u, meshesSize);
+        isRebindRequired |= m_meshRequestsBuffer.reserve(meshRequestsSize);
+        if (meshRequestsSize > 0u) {
+            NOX::Compute::enqueueFillBuffer(*m_meshRequestsBuffer, &s_meshRequestFillPattern, sizeof(cl_uint), meshRequestsSize);
+        }
+
+        std::cout << "Geometry cache: " << m_residentChunksCount << "/" << chunksCount << " chunks resident in " << m_slotChunks.size() << " slots" << std::endl;
+        return isRebindRequired;
+    }
+
+    void GeometryCache::processRequests(const AccelerationStructure &accelerationStructure) {
+        m_frameIndex++;
+        if (m_residentChunksCount == m_meshes.size()) {
+            return;
+        }
+
+        const auto meshRequestsSize = m_meshRequests.size() * sizeof(cl_uint);
+        NOX::Compute::enqueueReadBuffer(*m_meshRequestsBuffer, 0u, meshRequestsSize, m_meshRequests.data());
+        NOX::Compute::enqueueFillBuffer(*m_meshRequestsBuffer, &s_meshRequestFillPattern, sizeof(cl_uint), meshRequestsSize);
+
+        for (size_t chunkIndex = 0u; chunkIndex < m_meshRequests.size(); chunkIndex++) {
+            if (m_meshRequests[chunkIndex] != 0u) {
+                m_chunkLastUsedFrames[chunkIndex] = m_frameIndex;
+            }
+        }
+
+        const auto slots = getSlotsByLastUse();
+        const auto maxLoadsCount = std::min<size_t>(s_maxChunkLoadsPerFrame, slots.size());
+        size_t loadsCount = 0u;
+        for (uint32_t chunkIndex = 0u; chunkIndex < m_meshRequests.size() && loadsCount < maxLoadsCount; chunkIndex++) {
+            if (m_meshRequests[chunkIndex] == 0u || m_meshes[chunkIndex].isResident != 0u) {
+                continue;
+            }
+
+            const auto slot = slots[loadsCount];
+            if (m_slotChunks[slot] != s_invalidChunkIndex) {
+                evictSlot(slot);
+            }
+
+            loadChunk(accelerationStructure, chunkIndex, slot);
+            loadsCount++;
+        }
+
+        if (loadsCount > 0u) {
+            const auto meshesSize = m_meshes.size() * sizeof(KernelTypes::Mesh);
+            m_meshesBuffer.upload(m_meshes.data(), meshesSize, 0u, meshesSize);
+        }
+    }
+
+    bool GeometryCache::allocateSlots(const AccelerationStructure &accelerationStructure) {
+        const auto &chunks = accelerationStructure.getChunks();
+        size_t slotNodesCount = 1u;
+        size_t slotTrianglesCount = 1u;
+        for (const auto &chunk : chunks) {
+            slotNodesCount = std::max<size_t>(slotNodesCount, chunk.nodesCount);
+            slotTrianglesCount = std::max<size_t>(slotTrianglesCount, chunk.trianglesCount);
+        }
+
+        const auto slotNodesSize = slotNodesCount * sizeof(KernelTypes::BVHNode);
+        const auto slotTrianglesSize = slotTrianglesCount * sizeof(KernelTypes::Triangle);
+        auto slotsCount = std::max<size_t>(chunks.size(), 1u);
+        if (m_memoryTracker->getGlobalMemorySize() != 0u) {
+            const auto poolsSize = m_slotChunks.size() * (m_slotNodesCount * sizeof(KernelTypes::BVHNode) + m_slotTrianglesCount * sizeof(KernelTypes::Triangle));
+            const auto usedSize = m_memoryTracker->getTotalUsage().current - poolsSize;
+            const auto budget = m_memoryTracker->getBudget();
+            const auto availableSize = std::min(getMemoryLimit(), budget - std::min(budget, usedSize));
+            const auto maxAllocationSize = m_memoryTracker->getMaxAllocationSize();
+
+            slotsCount = std::min({slotsCount, availableSize / (slotNodesSize + slotTrianglesSize), maxAllocationSize / slotNodesSize, maxAllocationSize / slotTrianglesSize});
+            slotsCount = std::max<size_t>(slotsCount, 1u);
+        }
+
+        if (slotNodesCount <= m_slotNodesCount && slotTrianglesCount <= m_slotTrianglesCount && slotsCount == m_slotChunks.size()) {
+            return false;
+        }
+
+        m_bottomLevelNodesBuffer.reset();
+        m_trianglesBuffer.reset();
+        m_bottomLevelNodesBuffer = m_memoryTracker->createBuffer(DeviceMemoryCategory::BVH, NOX::MemoryUsage::READ_ONLY, slotsCount * slotNodesSize);
+        m_trianglesBuffer = m_memoryTracker->createBuffer(DeviceMemoryCategory::TRIANGLES, NOX::MemoryUsage::READ_ONLY, slotsCount * slotTrianglesSize);
+        m_slotNodesCount = slotNodesCount;
+        m_slotTrianglesCount = slotTrianglesCount;
+
+        m_slotChunks.assign(slotsCount, s_invalidChunkIndex);
+        for (auto &mesh : m_meshes) {
+            mesh.isResident = 0u;
+        }
+        m_residentChunksCount = 0u;
+
+        return true;
+    }
+
+    bool GeometryCache::wrapChunks(const AccelerationStructure &accelerationStructure) {
+        const auto &chunks = accelerationStructure.getChunks();
+        const auto &nodes = accelerationStructure.getChunkNodes();
+        const auto &triangles = accelerationStructure.getChunkTriangles();
+
+        m_bottomLevelNodesBuffer.reset();
+        m_trianglesBuffer.reset();
+        m_bottomLevelNodesBuffer = wrapHostMemory(*m_memoryTracker, DeviceMemoryCategory::BVH, nodes.data(), nodes.size() * sizeof(KernelTypes::BVHNode));
+        m_trianglesBuffer = wrapHostMemory(*m_memoryTracker, DeviceMemoryCategory::TRIANGLES, triangles.data(), triangles.size() * sizeof(KernelTypes::Triangle));
+        m_slotChunks.clear();
+        m_slotNodesCount = 0u;
+        m_slotTrianglesCount = 0u;
+
+        m_meshes.resize(chunks.size());
+        for (size_t chunkIndex = 0u; chunkIndex < chunks.size(); chunkIndex++) {
+            m_meshes[chunkIndex] = {chunks[chunkIndex].nodeOffset, chunks[chunkIndex].triangleOffset, 1u, 0u};
+        }
+        m_residentChunksCount = chunks.size();
+
+        return true;
+    }
+
+    uint32_t GeometryCache::findFreeSlot() const {
+        for (uint32_t slot = 0u; slot < m_slotChunks.size(); slot++) {
+            if (m_slotChunks[slot] == s_invalidChunkIndex) {
+                return slot;
+            }
+        }
+
+        return s_invalidSlot;
+    }
+
+    std::vector<uint32_t> GeometryCache::getSlotsByLastUse() const {
+        const auto getLastUsedFrame = [this](uint32_t slot) {
+            const auto chunkIndex = m_slotChunks[slot];
+            return chunkIndex == s_invalidChunkIndex ? uint64_t{0u} : m_chunkLastUsedFrames[chunkIndex] + 1u;
+        };
+
+        std::vector<uint32_t> slots(m_slotChunks.size());
+        std::iota(slots.begin(), slots.end(), 0u);
+        std::stable_sort(slots.begin(), slots.end(), [&getLastUsedFrame](uint32_t a, uint32_t b) {
+            return getLastUsedFrame(a) < getLastUsedFrame(b);
+        });
+
+        return slots;
+    }
+
+    void GeometryCache::loadChunk(const AccelerationStructure &accelerationStructure, uint32_t chunkIndex, uint32_t slot) {
+        const auto &chunk = accelerationStructure.getChunks()[chunkIndex];
+        const auto nodeOffset = static_cast<cl_uint>(slot * m_slotNodesCount);
+        const auto triangleOffset = static_cast<cl_uint>(slot * m_slotTrianglesCount);
+        const auto *nodes = &accelerationStructure.getChunkNodes()[chunk.nodeOffset];
+        const auto *triangles = &accelerationStructure.getChunkTriangles()[chunk.triangleOffset];
+        NOX::Compute::enqueueWriteBuffer(*m_bottomLevelNodesBuffer, nodeOffset * sizeof(KernelTypes::BVHNode), chunk.nodesCount * sizeof(KernelTypes::BVHNode), nodes);
+        NOX::Compute::enqueueWriteBuffer(*m_trianglesBuffer, triangleOffset * sizeof(KernelTypes::Triangle), chunk.trianglesCount * sizeof(KernelTypes::Triangle), triangles);
+
+        m_meshes[chunkIndex] = {nodeOffset, triangleOffset, 1u, 0u};
+        m_slotChunks[slot] = chunkIndex;
+        m_residentChunksCount++;
+    }
+
+    void GeometryCache::evictSlot(uint32_t slot) {
+        m_meshes[m_slotChunks[slot]].isResident = 0u;
+        m_slotChunks[slot] = s_invalidChunkIndex;
+        m_residentChunksCount--;
+    }
+
+} // namespace NOXPT
@@ -0,0 +1,55 @@
+#pragma once
+
+#include "acceleration_structure.h"
+#include "device_buffer.h"
+#include "device_memory_tracker.h"
+#include "kernel_types.h"
+
+#include <nox/compute/compute_buffer.h>
+
+#include <memory>
+#include <vector>
+
+namespace NOXPT {
+
+    class GeometryCache {
+      public:
+        explicit GeometryCache(DeviceMemoryTracker &memoryTracker);
+
+        const NOX::ComputeBuffer &getMeshesBuffer() const { return *m_meshesBuffer; }
+        const NOX::ComputeBuffer &getBottomLevelNodesBuffer() const { return *m_bottomLevelNodesBuffer; }
+        const NOX::ComputeBuffer &getTrianglesBuffer() const { return *m_trianglesBuffer; }
+        const NOX::ComputeBuffer &getMeshRequestsBuffer() const { return *m_meshRequestsBuffer; }
+        size_t getSlotsCount() const { return m_slotChunks.size(); }
+        size_t getResidentChunksCount() const { return m_residentChunksCount; }
+        size_t getMemoryLimit() const;
+
+        bool update(const AccelerationStructure &accelerationStructure, size_t firstChangedChunk);
+        void processRequests(const AccelerationStructure &accelerationStructure);
+
+      private:
+        bool allocateSlots(const AccelerationStructure &accelerationStructure);
+        bool wrapChunks(const AccelerationStructure &accelerationStructure);
+        uint32_t findFreeSlot() const;
+        std::vector<uint32_t> getSlotsByLastUse() const;
+        void loadChunk(const AccelerationStructure &accelerationStructure, uint32_t chunkIndex, uint32_t slot);
+        void evictSlot(uint32_t slot);
+
+      private:
+        DeviceMemoryTracker *m_memoryTracker{nullptr};
+        DeviceBuffer m_meshesBuffer;
+        DeviceBuffer m_meshRequestsBuffer;
+        std::shared_ptr<NOX::ComputeBuffer> m_bottomLevelNodesBuffer{nullptr};
+        std::shared_ptr<NOX::ComputeBuffer> m_trianglesBuffer{nullptr};
+
+        std::vector<KernelTypes::Mesh> m_meshes{};
+        std::vector<cl_uint> m_meshRequests{};
+        std::vector<uint64_t> m_chunkLastUsedFrames{};
+        std::vector<uint32_t> m_slotChunks{};
+        size_t m_slotNodesCount{0u};
+        size_t m_slotTrianglesCount{0u};
+        size_t m_residentChunksCount{0u};
+        uint64_t m_frameIndex{0u};
+    };
+
+} // namespace NOXPT
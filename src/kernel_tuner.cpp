@@ -0,0 +1,175 @@
+#include "kernel_tuner.h"
+
+#include <nox/compute/compute.h>
+
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+namespace NOXPT {
+
+    namespace {
+
+        constexpr size_t s_deviceInfoLength = 256u;
+        constexpr char s_profileSeparator = '\t';
+        constexpr std::array<size_t, 2> s_defaultLocalWorkSize = {0u, 0u};
+        constexpr std::array<std::array<size_t, 2>, 12> s_localWorkSizeCandidates = {{{8u, 8u},
+                                                                                      {16u, 8u},
+                                                                                      {8u, 16u},
+                                                                                      {16u, 16u},
+                                                                                      {32u, 2u},
+                                                                                      {32u, 4u},
+                                                                                      {32u, 8u},
+                                                                                      {64u, 1u},
+                                                                                      {64u, 2u},
+                                                                                      {64u, 4u},
+                                                                                      {128u, 1u},
+                                                                                      {256u, 1u}}};
+
+        std::string getDeviceString(cl_device_info parameter) {
+            char value[s_deviceInfoLength]{};
+            NOX::Compute::getDeviceInfo(parameter, sizeof(value) - 1u, value);
+            return value;
+        }
+
+        std::string formatLocalWorkSize(const std::array<size_t, 2> &localWorkSize) {
+            if (localWorkSize == s_defaultLocalWorkSize) {
+                return "default";
+            }
+
+            return std::to_string(localWorkSize[0]) + "x" + std::to_string(localWorkSize[1]);
+        }
+
+    } // namespace
+
+    const size_t *KernelTuner::getLocalWorkSize(const std::string &kernelName) const {
+        const auto it = m_localWorkSizes.find(kernelName);
+        if (it == m_localWorkSizes.end() || it->second == s_defaultLocalWorkSize) {
+            return nullptr;
+        }
+
+        return it->second.data();
+    }
+
+    void KernelTuner::initialize(const std::string &profilePath, const std::string &sceneKey) {
+        m_profilePath = profilePath;
+        m_profileKey = getDeviceString(CL_DEVICE_NAME) + s_profileSeparator + getDeviceString(CL_DRIVER_VERSION) + s_profileSeparator + sceneKey;
+        NOX::Compute::getDeviceInfo(CL_DEVICE_MAX_WORK_GROUP_SIZE, sizeof(size_t), &m_maxWorkGroupSize);
+
+        m_localWorkSizes.clear();
+        m_otherProfilesEntries.clear();
+        m_tuningKernels.clear();
+
+        std::ifstream file(m_profilePath);
+        std::string line{};
+        while (std::getline(file, line)) {
+            if (line.compare(0, m_profileKey.size() + 1u, m_profileKey + s_profileSeparator) != 0) {
+                m_otherProfilesEntries.push_back(line);
+                continue;
+            }
+
+            std::istringstream entry(line.substr(m_profileKey.size() + 1u));
+            std::string kernelName{};
+            std::array<size_t, 2> localWorkSize{};
+            if (std::getline(entry, kernelName, s_profileSeparator) && (entry >> localWorkSize[0] >> localWorkSize[1])) {
+                m_localWorkSizes[kernelName] = localWorkSize;
+            }
+        }
+    }
+
+    void KernelTuner::tune(const std::string &kernelName, const size_t *globalWorkSize, uint32_t iterations) {
+        TuningKernel tuningKernel{};
+        tuningKernel.candidates.push_back(s_defaultLocalWorkSize);
+        for (const auto &candidate : s_localWorkSizeCandidates) {
+            const auto isDivisor = (globalWorkSize[0] % candidate[0] == 0u) && (globalWorkSize[1] % candidate[1] == 0u);
+            const auto isWithinLimit = (m_maxWorkGroupSize == 0u) || (candidate[0] * candidate[1] <= m_maxWorkGroupSize);
+            if (isDivisor && isWithinLimit) {
+                tuningKernel.candidates.push_back(candidate);
+            }
+        }
+        tuningKernel.iterations = std::max(iterations, 1u);
+        tuningKernel.bestLocalWorkSize = s_defaultLocalWorkSize;
+
+        m_tuningKernels[kernelName] = std::move(tuningKernel);
+    }
+
+    bool KernelTuner::launch(const std::string &kernelName, const Launch &launch) {
+        const auto it = m_tuningKernels.find(kernelName);
+        if (it == m_tuningKernels.end()) {
+            launch(getLocalWorkSize(kernelName));
+            return false;
+        }
+
+        auto &tuningKernel = it->second;
+        const auto &candidate = tuningKernel.candidates[tuningKernel.candidateIndex];
+        const auto *localWorkSize = (candidate == s_defaultLocalWorkSize) ? nullptr : candidate.data();
+        if (tuningKernel.launchesCount++ == 0u) {
+            launch(localWorkSize);
+            return false;
+        }
+
+        NOX::Compute::finish();
+        const auto startTime = std::chrono::steady_clock::now();
+        launch(localWorkSize);
+        NOX::Compute::finish();
+        tuningKernel.time += std::chrono::duration<float>(std::chrono::steady_clock::now() - startTime).count();
+
+        if (tuningKernel.launchesCount <= tuningKernel.iterations || !finishCandidate(kernelName, tuningKernel)) {
+            return false;
+        }
+
+        m_tuningKernels.erase(it);
+        return true;
+    }
+
+    bool KernelTuner::finishCandidate(const std::string &kernelName, TuningKernel &tuningKernel) {
+        const auto time = tuningKernel.time / static_cast<float>(tuningKernel.iterations);
+        if (tuningKernel.candidateIndex == 0u) {
+            tuningKernel.defaultTime = time;
+            tuningKernel.bestTime = time;
+        } else if (time < tuningKernel.bestTime) {
+            tuningKernel.bestTime = time;
+            tuningKernel.bestLocalWorkSize = tuningKernel.candidates[tuningKernel.candidateIndex];
+        }
+
+        tuningKernel.candidateIndex++;
+        tuningKernel.launchesCount = 0u;
+        tuningKernel.time = 0.0f;
+        if (tuningKernel.candidateIndex < tuningKernel.candidates.size()) {
+            return false;
+        }
+
+        m_localWorkSizes[kernelName] = tuningKernel.bestLocalWorkSize;
+        std::cout << "Kernel tuner: " << kernelName << " " << formatLocalWorkSize(tuningKernel.bestLocalWorkSize) << " (" << tuningKernel.bestTime * 1000.0f
+                  << " ms, default " << tuningKernel.defaultTime * 1000.0f << " ms)" << std::endl;
+        return true;
+    }
+
+    void KernelTuner::saveProfile() const {
+        const auto temporaryPath = m_profilePath + "." + std::to_string(std::chrono::steady_clock::now().time_since_epoch().count()) + ".tmp";
+        {
+            std::ofstream file(temporaryPath, std::ios::out | std::ios::trunc);
+            if (!file.is_open()) {
+                return;
+            }
+
+            for (const auto &entry : m_otherProfilesEntries) {
+                file << entry << "\n";
+            }
+
+            for (const auto &[kernelName, localWorkSize] : m_localWorkSizes) {
+                file << m_profileKey << s_profileSeparator << kernelName << s_profileSeparator << localWorkSize[0] << " " << localWorkSize[1] << "\n";
+            }
+        }
+
+        std::error_code error{};
+        std::filesystem::rename(temporaryPath, m_profilePath, error);
+        if (error) {
+            std::filesystem::remove(temporaryPath, error);
+        }
+    }
+
+} // namespace NOXPT
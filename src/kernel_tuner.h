@@ -0,0 +1,47 @@
+#pragma once
+
+#include <array>
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace NOXPT {
+
+    class KernelTuner {
+      public:
+        using Launch = std::function<void(const size_t *localWorkSize)>;
+
+        const size_t *getLocalWorkSize(const std::string &kernelName) const;
+        bool isTuned(const std::string &kernelName) const { return m_localWorkSizes.count(kernelName) > 0u; }
+
+        void initialize(const std::string &profilePath, const std::string &sceneKey);
+        void tune(const std::string &kernelName, const size_t *globalWorkSize, uint32_t iterations);
+        bool launch(const std::string &kernelName, const Launch &launch);
+        void saveProfile() const;
+
+      private:
+        struct TuningKernel {
+            std::vector<std::array<size_t, 2>> candidates{};
+            size_t candidateIndex{0u};
+            uint32_t iterations{0u};
+            uint32_t launchesCount{0u};
+            float time{0.0f};
+            float defaultTime{0.0f};
+            float bestTime{0.0f};
+            std::array<size_t, 2> bestLocalWorkSize{};
+        };
+
+      private:
+        bool finishCandidate(const std::string &kernelName, TuningKernel &tuningKernel);
+
+      private:
+        std::string m_profilePath{};
+        std::string m_profileKey{};
+        size_t m_maxWorkGroupSize{0u};
+        std::unordered_map<std::string, std::array<size_t, 2>> m_localWorkSizes{};
+        std::vector<std::string> m_otherProfilesEntries{};
+        std::unordered_map<std::string, TuningKernel> m_tuningKernels{};
+    };
+
+} // namespace NOXPT
@@ -4,13 +4,37 @@
 
 namespace NOXPT::KernelTypes {
 
+    enum class LightType : cl_uint {
+        RECTANGLE = 0u,
+        TRIANGLE = 1u
+    };
+
     struct Light {
         cl_float3 position;
         cl_float3 emission;
         cl_float3 u;
         cl_float3 v;
         cl_float area;
-        cl_uint padding[3];
+        cl_uint type;
+        cl_uint padding[2];
+    };
+
+    struct LightAliasEntry {
+        cl_float probability;
+        cl_float pmf;
+        cl_uint alias;
+        cl_uint padding;
+    };
+
+    struct Camera {
+        cl_float3 position;
+        cl_float3 forward;
+        cl_float3 right;
+        cl_float3 up;
+        cl_float fov;
+        cl_float aspectRatio;
+        cl_float width;
+        cl_float height;
     };
 
     struct Material {
@@ -32,17 +56,42 @@ namespace NOXPT::KernelTypes {
         cl_uint padding[3];
     };
 
-    struct BoundingBox {
-        cl_float3 minimum;
-        cl_float3 maximum;
+    struct BVHNode {
+        cl_float4 leftBoundsXY;
+        cl_float4 rightBoundsXY;
+        cl_float4 childrenBoundsZ;
+        cl_uint leftIndex;
+        cl_uint rightIndex;
+        cl_uint childrenTriangleCounts;
+        cl_uint parentIndex;
     };
 
-    struct BVHNode {
-        BoundingBox bounds;
-        cl_uint firstTriangleOffset;
-        cl_uint triangleCount;
-        cl_uint splitAxis;
+    struct Mesh {
+        cl_uint nodeOffset;
+        cl_uint triangleOffset;
+        cl_uint isResident;
         cl_uint padding;
     };
 
+    struct Instance {
+        cl_float4 objectToWorld[3];
+        cl_float4 worldToObject[3];
+        cl_uint meshIndex;
+        cl_uint padding[3];
+    };
+
+    struct PathState {
+        cl_float4 origin;
+        cl_float4 direction;
+        cl_float4 throughput;
+        cl_float4 radiance;
+        cl_float4 albedo;
+        cl_float4 normalDepth;
+        cl_uint2 seed;
+        cl_uint sampleIndex;
+        cl_uint bounce;
+        cl_uint isActive;
+        cl_uint padding[3];
+    };
+
 } // namespace NOXPT::KernelTypes
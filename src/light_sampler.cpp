@@ -0,0 +1,76 @@
+#include "light_sampler.h"
+
+#include <algorithm>
+
+namespace NOXPT {
+
+    namespace {
+
+        float lightPower(const KernelTypes::Light &light) {
+            const auto luminance = 0.212671f * light.emission.s[0] + 0.715160f * light.emission.s[1] + 0.072169f * light.emission.s[2];
+            return luminance * light.area;
+        }
+
+    } // namespace
+
+    void LightSampler::build(const std::vector<KernelTypes::Light> &lights) {
+        const auto lightsCount = lights.size();
+        m_aliasTable.assign(lightsCount, KernelTypes::LightAliasEntry{});
+        if (lightsCount == 0u) {
+            return;
+        }
+
+        std::vector<float> powers(lightsCount);
+        float totalPower = 0.0f;
+        for (size_t i = 0; i < lightsCount; i++) {
+            powers[i] = std::max(lightPower(lights[i]), 0.0f);
+            totalPower += powers[i];
+        }
+
+        if (totalPower <= 0.0f) {
+            std::fill(powers.begin(), powers.end(), 1.0f);
+            totalPower = static_cast<float>(lightsCount);
+        }
+
+        std::vector<float> scaledProbabilities(lightsCount);
+        std::vector<uint32_t> small{}, large{};
+        for (size_t i = 0; i < lightsCount; i++) {
+            m_aliasTable[i].pmf = powers[i] / totalPower;
+            scaledProbabilities[i] = m_aliasTable[i].pmf * static_cast<float>(lightsCount);
+
+            if (scaledProbabilities[i] < 1.0f) {
+                small.push_back(static_cast<uint32_t>(i));
+            } else {
+                large.push_back(static_cast<uint32_t>(i));
+            }
+        }
+
+        while (!small.empty() && !large.empty()) {
+            const auto lessIndex = small.back();
+            small.pop_back();
+            const auto moreIndex = large.back();
+            large.pop_back();
+
+            m_aliasTable[lessIndex].probability = scaledProbabilities[lessIndex];
+            m_aliasTable[lessIndex].alias = moreIndex;
+
+            scaledProbabilities[moreIndex] = (scaledProbabilities[moreIndex] + scaledProbabilities[lessIndex]) - 1.0f;
+            if (scaledProbabilities[moreIndex] < 1.0f) {
+                small.push_back(moreIndex);
+            } else {
+                large.push_back(moreIndex);
+            }
+        }
+
+        for (const auto index : small) {
+            m_aliasTable[index].probability = 1.0f;
+            m_aliasTable[index].alias = index;
+        }
+
+        for (const auto index : large) {
+            m_aliasTable[index].probability = 1.0f;
+            m_aliasTable[index].alias = index;
+        }
+    }
+
+} // namespace NOXPT
@@ -0,0 +1,19 @@
+#pragma once
+
+#include "kernel_types.h"
+
+#include <vector>
+
+namespace NOXPT {
+
+    class LightSampler {
+      public:
+        const std::vector<KernelTypes::LightAliasEntry> &getAliasTable() const { return m_aliasTable; }
+
+        void build(const std::vector<KernelTypes::Light> &lights);
+
+      private:
+        std::vector<KernelTypes::LightAliasEntry> m_aliasTable{};
+    };
+
+} // namespace NOXPT
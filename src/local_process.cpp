@@ -0,0 +1,155 @@
+#include "local_process.h"
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <signal.h>
+#include <spawn.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+extern char **environ;
+#endif
+
+#include <chrono>
+#include <cstdlib>
+#include <thread>
+#include <utility>
+
+namespace NOXPT {
+
+    namespace {
+
+        constexpr auto s_waitPollInterval = std::chrono::milliseconds(10);
+
+#ifdef _WIN32
+        std::string quoteArgument(const std::string &argument) {
+            return "\"" + argument + "\"";
+        }
+#endif
+
+    } // namespace
+
+    LocalProcess::~LocalProcess() {
+        if (isValid()) {
+            terminate();
+            wait(UINT32_MAX);
+        }
+    }
+
+    LocalProcess::LocalProcess(LocalProcess &&other) noexcept : m_handle(std::exchange(other.m_handle, -1)),
+                                                                m_id(std::exchange(other.m_id, 0u)) {}
+
+    LocalProcess &LocalProcess::operator=(LocalProcess &&other) noexcept {
+        if (this != &other) {
+            if (isValid()) {
+                terminate();
+                wait(UINT32_MAX);
+            }
+
+            m_handle = std::exchange(other.m_handle, -1);
+            m_id = std::exchange(other.m_id, 0u);
+        }
+
+        return *this;
+    }
+
+    LocalProcess LocalProcess::start(const std::string &executablePath, const std::vector<std::string> &arguments) {
+#ifdef _WIN32
+        auto commandLine = quoteArgument(executablePath);
+        for (const auto &argument : arguments) {
+            commandLine += " " + quoteArgument(argument);
+        }
+
+        STARTUPINFOA startupInfo{};
+        startupInfo.cb = sizeof(startupInfo);
+        startupInfo.dwFlags = STARTF_USESHOWWINDOW;
+        startupInfo.wShowWindow = SW_HIDE;
+
+        PROCESS_INFORMATION processInformation{};
+        if (!CreateProcessA(executablePath.c_str(), commandLine.data(), nullptr, nullptr, FALSE, CREATE_NO_WINDOW, nullptr, nullptr, &startupInfo, &processInformation)) {
+            return {};
+        }
+
+        CloseHandle(processInformation.hThread);
+        return LocalProcess(reinterpret_cast<intptr_t>(processInformation.hProcess), static_cast<uint32_t>(processInformation.dwProcessId));
+#else
+        std::vector<std::string> argumentsStorage{executablePath};
+        argumentsStorage.insert(argumentsStorage.end(), arguments.begin(), arguments.end());
+
+        std::vector<char *> argv{};
+        for (auto &argument : argumentsStorage) {
+            argv.push_back(argument.data());
+        }
+        argv.push_back(nullptr);
+
+        pid_t processId = 0;
+        if (posix_spawn(&processId, executablePath.c_str(), nullptr, nullptr, argv.data(), environ) != 0) {
+            return {};
+        }
+
+        return LocalProcess(static_cast<intptr_t>(processId), static_cast<uint32_t>(processId));
+#endif
+    }
+
+    uint32_t LocalProcess::getCurrentId() {
+#ifdef _WIN32
+        return static_cast<uint32_t>(GetCurrentProcessId());
+#else
+        return static_cast<uint32_t>(getpid());
+#endif
+    }
+
+    bool LocalProcess::isValid() const {
+        return m_handle != -1;
+    }
+
+    bool LocalProcess::wait(uint32_t timeoutMilliseconds) {
+        if (!isValid()) {
+            return true;
+        }
+
+#ifdef _WIN32
+        if (WaitForSingleObject(reinterpret_cast<HANDLE>(m_handle), timeoutMilliseconds == UINT32_MAX ? INFINITE : timeoutMilliseconds) != WAIT_OBJECT_0) {
+            return false;
+        }
+#else
+        const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMilliseconds);
+        int status = 0;
+        while (waitpid(static_cast<pid_t>(m_handle), &status, timeoutMilliseconds == UINT32_MAX ? 0 : WNOHANG) == 0) {
+            if (std::chrono::steady_clock::now() >= deadline) {
+                return false;
+            }
+
+            std::this_thread::sleep_for(s_waitPollInterval);
+        }
+#endif
+
+        release();
+        return true;
+    }
+
+    void LocalProcess::terminate() const {
+        if (!isValid()) {
+            return;
+        }
+
+#ifdef _WIN32
+        TerminateProcess(reinterpret_cast<HANDLE>(m_handle), EXIT_FAILURE);
+#else
+        kill(static_cast<pid_t>(m_handle), SIGKILL);
+#endif
+    }
+
+    void LocalProcess::release() {
+#ifdef _WIN32
+        CloseHandle(reinterpret_cast<HANDLE>(m_handle));
+#endif
+        m_handle = -1;
+        m_id = 0u;
+    }
+
+} // namespace NOXPT
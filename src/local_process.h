@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace NOXPT {
+
+    class LocalProcess {
+      public:
+        LocalProcess() = default;
+        ~LocalProcess();
+
+        LocalProcess(const LocalProcess &) = delete;
+        LocalProcess &operator=(const LocalProcess &) = delete;
+        LocalProcess(LocalProcess &&other) noexcept;
+        LocalProcess &operator=(LocalProcess &&other) noexcept;
+
+        static LocalProcess start(const std::string &executablePath, const std::vector<std::string> &arguments);
+        static uint32_t getCurrentId();
+
+        bool isValid() const;
+        uint32_t getId() const { return m_id; }
+
+        bool wait(uint32_t timeoutMilliseconds);
+        void terminate() const;
+
+      private:
+        LocalProcess(intptr_t handle, uint32_t id) : m_handle(handle),
+                                                     m_id(id) {}
+
+        void release();
+
+      private:
+        intptr_t m_handle{-1};
+        uint32_t m_id{0u};
+    };
+
+} // namespace NOXPT
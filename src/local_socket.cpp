@@ -0,0 +1,209 @@
+#include "local_socket.h"
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+#include <algorithm>
+#include <utility>
+
+namespace NOXPT {
+
+    namespace {
+
+#ifdef _WIN32
+        using SocketHandle = SOCKET;
+        using SocketLength = int;
+
+        struct SocketLibrary {
+            SocketLibrary() {
+                WSADATA data{};
+                WSAStartup(MAKEWORD(2, 2), &data);
+            }
+
+            ~SocketLibrary() {
+                WSACleanup();
+            }
+        };
+
+        void initializeSocketLibrary() {
+            static SocketLibrary socketLibrary{};
+        }
+
+        void closeSocket(SocketHandle handle) {
+            closesocket(handle);
+        }
+#else
+        using SocketHandle = int;
+        using SocketLength = socklen_t;
+
+        void initializeSocketLibrary() {}
+
+        void closeSocket(SocketHandle handle) {
+            ::close(handle);
+        }
+#endif
+
+        constexpr int s_listenBacklog = 16;
+        constexpr size_t s_maxTransferSize = 1u << 30u;
+#ifdef MSG_NOSIGNAL
+        constexpr int s_sendFlags = MSG_NOSIGNAL;
+#else
+        constexpr int s_sendFlags = 0;
+#endif
+
+        SocketHandle toSocket(intptr_t handle) {
+            return static_cast<SocketHandle>(handle);
+        }
+
+        sockaddr_in createLoopbackAddress(uint16_t port) {
+            sockaddr_in address{};
+            address.sin_family = AF_INET;
+            address.sin_port = htons(port);
+            address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+            return address;
+        }
+
+    } // namespace
+
+    LocalSocket::~LocalSocket() {
+        close();
+    }
+
+    LocalSocket::LocalSocket(LocalSocket &&other) noexcept : m_handle(std::exchange(other.m_handle, -1)) {}
+
+    LocalSocket &LocalSocket::operator=(LocalSocket &&other) noexcept {
+        if (this != &other) {
+            close();
+            m_handle = std::exchange(other.m_handle, -1);
+        }
+
+        return *this;
+    }
+
+    LocalSocket LocalSocket::listen(uint16_t port) {
+        initializeSocketLibrary();
+
+        LocalSocket localSocket(static_cast<intptr_t>(socket(AF_INET, SOCK_STREAM, IPPROTO_TCP)));
+        if (!localSocket.isValid()) {
+            return {};
+        }
+
+        const auto address = createLoopbackAddress(port);
+        const auto handle = toSocket(localSocket.m_handle);
+        if (bind(handle, reinterpret_cast<const sockaddr *>(&address), sizeof(address)) != 0 || ::listen(handle, s_listenBacklog) != 0) {
+            return {};
+        }
+
+        return localSocket;
+    }
+
+    LocalSocket LocalSocket::connect(uint16_t port) {
+        initializeSocketLibrary();
+
+        LocalSocket localSocket(static_cast<intptr_t>(socket(AF_INET, SOCK_STREAM, IPPROTO_TCP)));
+        if (!localSocket.isValid()) {
+            return {};
+        }
+
+        const auto address = createLoopbackAddress(port);
+        if (::connect(toSocket(localSocket.m_handle), reinterpret_cast<const sockaddr *>(&address), sizeof(address)) != 0) {
+            return {};
+        }
+
+        return localSocket;
+    }
+
+    bool LocalSocket::isValid() const {
+        return toSocket(m_handle) != toSocket(-1);
+    }
+
+    uint16_t LocalSocket::getPort() const {
+        sockaddr_in address{};
+        SocketLength addressLength = sizeof(address);
+        if (!isValid() || getsockname(toSocket(m_handle), reinterpret_cast<sockaddr *>(&address), &addressLength) != 0) {
+            return 0u;
+        }
+
+        return ntohs(address.sin_port);
+    }
+
+    LocalSocket LocalSocket::accept(uint32_t timeoutMilliseconds) const {
+        if (!isValid()) {
+            return {};
+        }
+
+        const auto handle = toSocket(m_handle);
+        fd_set readSet;
+        FD_ZERO(&readSet);
+        FD_SET(handle, &readSet);
+
+        timeval timeout{};
+        timeout.tv_sec = static_cast<decltype(timeout.tv_sec)>(timeoutMilliseconds / 1000u);
+        timeout.tv_usec = static_cast<decltype(timeout.tv_usec)>((timeoutMilliseconds % 1000u) * 1000u);
+        if (select(static_cast<int>(handle + 1), &readSet, nullptr, nullptr, &timeout) <= 0) {
+            return {};
+        }
+
+        return LocalSocket(static_cast<intptr_t>(::accept(handle, nullptr, nullptr)));
+    }
+
+    bool LocalSocket::setReceiveTimeout(uint32_t timeoutMilliseconds) const {
+#ifdef _WIN32
+        const DWORD timeout = timeoutMilliseconds;
+#else
+        timeval timeout{};
+        timeout.tv_sec = static_cast<decltype(timeout.tv_sec)>(timeoutMilliseconds / 1000u);
+        timeout.tv_usec = static_cast<decltype(timeout.tv_usec)>((timeoutMilliseconds % 1000u) * 1000u);
+#endif
+        return isValid() && setsockopt(toSocket(m_handle), SOL_SOCKET, SO_RCVTIMEO, reinterpret_cast<const char *>(&timeout), sizeof(timeout)) == 0;
+    }
+
+    bool LocalSocket::send(const void *data, size_t size) const {
+        const auto *bytes = static_cast<const char *>(data);
+        while (size > 0u) {
+            const auto sentSize = ::send(toSocket(m_handle), bytes, static_cast<int>(std::min(size, s_maxTransferSize)), s_sendFlags);
+            if (sentSize <= 0) {
+                return false;
+            }
+
+            bytes += sentSize;
+            size -= static_cast<size_t>(sentSize);
+        }
+
+        return true;
+    }
+
+    bool LocalSocket::receive(void *data, size_t size) const {
+        auto *bytes = static_cast<char *>(data);
+        while (size > 0u) {
+            const auto receivedSize = recv(toSocket(m_handle), bytes, static_cast<int>(std::min(size, s_maxTransferSize)), 0);
+            if (receivedSize <= 0) {
+                return false;
+            }
+
+            bytes += receivedSize;
+            size -= static_cast<size_t>(receivedSize);
+        }
+
+        return true;
+    }
+
+    void LocalSocket::close() {
+        if (isValid()) {
+            closeSocket(toSocket(m_handle));
+            m_handle = -1;
+        }
+    }
+
+} // namespace NOXPT
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace NOXPT {
+
+    class LocalSocket {
+      public:
+        LocalSocket() = default;
+        ~LocalSocket();
+
+        LocalSocket(const LocalSocket &) = delete;
+        LocalSocket &operator=(const LocalSocket &) = delete;
+        LocalSocket(LocalSocket &&other) noexcept;
+        LocalSocket &operator=(LocalSocket &&other) noexcept;
+
+        static LocalSocket listen(uint16_t port);
+        static LocalSocket connect(uint16_t port);
+
+        bool isValid() const;
+        uint16_t getPort() const;
+
+        LocalSocket accept(uint32_t timeoutMilliseconds) const;
+        bool setReceiveTimeout(uint32_t timeoutMilliseconds) const;
+        bool send(const void *data, size_t size) const;
+        bool receive(void *data, size_t size) const;
+        void close();
+
+      private:
+        explicit LocalSocket(intptr_t handle) : m_handle(handle) {}
+
+      private:
+        intptr_t m_handle{-1};
+    };
+
+} // namespace NOXPT
@@ -2,7 +2,9 @@
 
 int main(int argc, char **argv) {
 	auto application = NOXPT::Application::createApplication({ argc, argv });
-	application->run();
+	if (!application->runWorker() && !application->runBenchmark()) {
+		application->run();
+	}
 	delete application;
 	application = nullptr;
 
@@ -0,0 +1,179 @@
+#include "model_loader.h"
+
+#include <glm/glm.hpp>
+
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+namespace NOXPT {
+
+    namespace {
+
+        constexpr uint32_t s_invalidMaterialIndex = 0xFFFFFFFFu;
+        constexpr uint32_t s_progressUpdateInterval = 4096u;
+        constexpr float s_defaultDiffuse = 0.6f;
+
+        glm::vec3 toVec3(const cl_float3 &value) {
+            return {value.s[0], value.s[1], value.s[2]};
+        }
+
+        cl_float3 readFloat3(std::istringstream &tokens) {
+            cl_float3 value = {0.0f, 0.0f, 0.0f};
+            tokens >> value.s[0] >> value.s[1] >> value.s[2];
+            return value;
+        }
+
+        KernelTypes::Material createDefaultMaterial() {
+            KernelTypes::Material material{};
+            material.diffuse = {s_defaultDiffuse, s_defaultDiffuse, s_defaultDiffuse};
+            material.emissive = {0.0f, 0.0f, 0.0f};
+            return material;
+        }
+
+        bool resolveIndex(long index, size_t count, size_t &resolvedIndex) {
+            const auto signedCount = static_cast<long>(count);
+            const auto zeroBasedIndex = index > 0 ? index - 1 : signedCount + index;
+            if (index == 0 || zeroBasedIndex < 0 || zeroBasedIndex >= signedCount) {
+                return false;
+            }
+
+            resolvedIndex = static_cast<size_t>(zeroBasedIndex);
+            return true;
+        }
+
+    } // namespace
+
+    bool ModelLoader::load(ModelData &model) {
+        std::ifstream file(m_path, std::ios::in | std::ios::binary | std::ios::ate);
+        if (!file.is_open()) {
+            std::cout << "Model loader: failed to open " << m_path << std::endl;
+            m_progress = 1.0f;
+            return false;
+        }
+
+        const auto fileSize = static_cast<float>(file.tellg());
+        file.seekg(0, std::ios::beg);
+
+        std::string line{};
+        uint32_t linesCount = 0u;
+        while (std::getline(file, line)) {
+            std::istringstream tokens(line);
+            std::string keyword{};
+            tokens >> keyword;
+
+            if (keyword == "v") {
+                m_positions.push_back(readFloat3(tokens));
+            } else if (keyword == "vn") {
+                m_normals.push_back(readFloat3(tokens));
+            } else if (keyword == "f") {
+                addFace(tokens, model);
+            } else if (keyword == "usemtl") {
+                tokens >> m_currentMaterial;
+            } else if (keyword == "mtllib") {
+                std::string materialLibrary{};
+                tokens >> materialLibrary;
+                loadMaterials(std::filesystem::path(m_path).parent_path() / materialLibrary, model);
+            }
+
+            if (++linesCount % s_progressUpdateInterval == 0u && fileSize > 0.0f) {
+                m_progress = static_cast<float>(file.tellg()) / fileSize;
+            }
+        }
+
+        m_positions = {};
+        m_normals = {};
+        m_progress = 1.0f;
+        return !model.triangles.empty();
+    }
+
+    void ModelLoader::loadMaterials(const std::filesystem::path &path, ModelData &model) {
+        std::ifstream file(path, std::ios::in | std::ios::binary);
+        if (!file.is_open()) {
+            std::cout << "Model loader: failed to open " << path.string() << std::endl;
+            return;
+        }
+
+        KernelTypes::Material *material = nullptr;
+        std::string line{};
+        while (std::getline(file, line)) {
+            std::istringstream tokens(line);
+            std::string keyword{};
+            tokens >> keyword;
+
+            if (keyword == "newmtl") {
+                std::string name{};
+                tokens >> name;
+                m_materialIndices[name] = static_cast<uint32_t>(model.materials.size());
+                model.materials.push_back(createDefaultMaterial());
+                material = &model.materials.back();
+            } else if (material != nullptr && keyword == "Kd") {
+                material->diffuse = readFloat3(tokens);
+            } else if (material != nullptr && keyword == "Ke") {
+                material->emissive = readFloat3(tokens);
+            }
+        }
+    }
+
+    void ModelLoader::addFace(std::istringstream &tokens, ModelData &model) {
+        std::vector<KernelTypes::Vertex> vertices{};
+        std::vector<bool> hasNormals{};
+        std::string token{};
+        while (tokens >> token) {
+            const auto firstSeparator = token.find('/');
+            const auto secondSeparator = firstSeparator == std::string::npos ? std::string::npos : token.find('/', firstSeparator + 1u);
+
+            size_t positionIndex = 0u;
+            if (!resolveIndex(std::strtol(token.c_str(), nullptr, 10), m_positions.size(), positionIndex)) {
+                return;
+            }
+
+            KernelTypes::Vertex vertex{};
+            vertex.position = m_positions[positionIndex];
+
+            size_t normalIndex = 0u;
+            const auto hasNormal = secondSeparator != std::string::npos &&
+                                   resolveIndex(std::strtol(token.c_str() + secondSeparator + 1u, nullptr, 10), m_normals.size(), normalIndex);
+            if (hasNormal) {
+                vertex.normal = m_normals[normalIndex];
+            }
+
+            vertices.push_back(vertex);
+            hasNormals.push_back(hasNormal);
+        }
+
+        const auto materialIndex = getCurrentMaterialIndex(model);
+        for (size_t i = 1u; i + 1u < vertices.size(); i++) {
+            KernelTypes::Triangle triangle{};
+            triangle.v0 = vertices[0];
+            triangle.v1 = vertices[i];
+            triangle.v2 = vertices[i + 1u];
+            triangle.materialIndex = materialIndex;
+
+            if (!hasNormals[0] || !hasNormals[i] || !hasNormals[i + 1u]) {
+                const auto normal = glm::cross(toVec3(triangle.v1.position) - toVec3(triangle.v0.position), toVec3(triangle.v2.position) - toVec3(triangle.v0.position));
+                const auto length = glm::length(normal);
+                const auto unitNormal = length > 0.0f ? normal / length : normal;
+                triangle.v0.normal = triangle.v1.normal = triangle.v2.normal = {unitNormal.x, unitNormal.y, unitNormal.z};
+            }
+
+            model.triangles.push_back(triangle);
+        }
+    }
+
+    uint32_t ModelLoader::getCurrentMaterialIndex(ModelData &model) {
+        const auto it = m_materialIndices.find(m_currentMaterial);
+        if (it != m_materialIndices.end()) {
+            return it->second;
+        }
+
+        if (m_defaultMaterialIndex == s_invalidMaterialIndex) {
+            m_defaultMaterialIndex = static_cast<uint32_t>(model.materials.size());
+            model.materials.push_back(createDefaultMaterial());
+        }
+
+        return m_defaultMaterialIndex;
+    }
+
+} // namespace NOXPT
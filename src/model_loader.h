@@ -0,0 +1,47 @@
+#pragma once
+
+#include "kernel_types.h"
+
+#include <atomic>
+#include <filesystem>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace NOXPT {
+
+    struct ModelData {
+        std::vector<KernelTypes::Triangle> triangles{};
+        std::vector<KernelTypes::Material> materials{};
+    };
+
+    class ModelLoader {
+      public:
+        explicit ModelLoader(const std::string &path) : m_path(path) {}
+
+        ModelLoader(const ModelLoader &) = delete;
+        ModelLoader &operator=(const ModelLoader &) = delete;
+
+        const std::string &getPath() const { return m_path; }
+        float getProgress() const { return m_progress; }
+
+        bool load(ModelData &model);
+
+      private:
+        void loadMaterials(const std::filesystem::path &path, ModelData &model);
+        void addFace(std::istringstream &tokens, ModelData &model);
+        uint32_t getCurrentMaterialIndex(ModelData &model);
+
+      private:
+        std::string m_path{};
+        std::atomic<float> m_progress{0.0f};
+
+        std::vector<cl_float3> m_positions{};
+        std::vector<cl_float3> m_normals{};
+        std::unordered_map<std::string, uint32_t> m_materialIndices{};
+        std::string m_currentMaterial{};
+        uint32_t m_defaultMaterialIndex{0xFFFFFFFFu};
+    };
+
+} // namespace NOXPT
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstddef>
+#include <new>
+#include <vector>
+
+namespace NOXPT {
+
+    template <typename T>
+    class PageAlignedAllocator {
+      public:
+        using value_type = T;
+
+        static constexpr size_t s_pageSize = 4096u;
+
+        PageAlignedAllocator() = default;
+
+        template <typename U>
+        PageAlignedAllocator(const PageAlignedAllocator<U> &) {}
+
+        T *allocate(size_t count) {
+            return static_cast<T *>(::operator new(count * sizeof(T), std::align_val_t{s_pageSize}));
+        }
+
+        void deallocate(T *pointer, size_t) {
+            ::operator delete(pointer, std::align_val_t{s_pageSize});
+        }
+
+        template <typename U>
+        bool operator==(const PageAlignedAllocator<U> &) const { return true; }
+
+        template <typename U>
+        bool operator!=(const PageAlignedAllocator<U> &) const { return false; }
+    };
+
+    template <typename T>
+    using PageAlignedVector = std::vector<T, PageAlignedAllocator<T>>;
+
+} // namespace NOXPT
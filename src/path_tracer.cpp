@@ -7,147 +7,718 @@
 
 #include <nox/compute/compute.h>
 
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
 namespace NOXPT {
 
     namespace {
 
         constexpr size_t s_globalWorkSize1D = 1280 * 720;
         constexpr size_t s_globalWorkSize2D[2] = {1280, 720};
-        constexpr uint32_t s_maxBounces = 3u;
 
-        constexpr size_t s_radianceValueSize = sizeof(cl_float3);
-        constexpr cl_float3 s_radianceFillPattern = {0.0f, 0.0f, 0.0f};
+        constexpr size_t s_raySize = sizeof(cl_float3) * 2;
+        constexpr size_t s_pathStateSize = sizeof(KernelTypes::PathState);
+        constexpr size_t s_sampleCountSize = sizeof(cl_uint);
+        constexpr size_t s_accumulationValueSize = sizeof(cl_float4);
+        constexpr size_t s_accumulationBuffersCount = 3u;
+        constexpr uint32_t s_minimumTileSize = 64u;
+        constexpr cl_uint s_rayCounterFillPattern = 0u;
+        constexpr cl_uint s_deferredPathFillPattern = 0u;
+        constexpr cl_uint s_sampleCountFillPattern = 0u;
+        constexpr cl_uint s_interactiveSampleIndexOffset = 0u;
+        constexpr float s_statisticsInterval = 1.0f;
+        constexpr const char *s_generatePrimaryRayKernelName = "generate_primary_ray";
+        constexpr const char *s_tracePathKernelName = "trace_path";
+        constexpr const char *s_computePixelKernelName = "compute_pixel";
+        constexpr cl_float4 s_accumulationFillPattern = {0.0f, 0.0f, 0.0f, 0.0f};
+
+        void setCameraVector(cl_float3 &destination, const glm::vec3 &source) {
+            destination = {source.x, source.y, source.z};
+        }
+
+        size_t estimateSceneMemory(const Scene &scene) {
+            size_t trianglesCount = 0u;
+            for (const auto &mesh : scene.getMeshes()) {
+                trianglesCount += mesh.trianglesCount;
+            }
+
+            const auto instancesCount = scene.getInstances().size();
+            return trianglesCount * (sizeof(KernelTypes::Triangle) + 2u * sizeof(KernelTypes::BVHNode)) +
+                   instancesCount * (sizeof(KernelTypes::Instance) + 2u * sizeof(KernelTypes::BVHNode)) +
+                   scene.getLights().size() * (sizeof(KernelTypes::Light) + sizeof(KernelTypes::LightAliasEntry)) +
+                   scene.getMaterials().size() * sizeof(KernelTypes::Material);
+        }
+
+        std::string getSceneKey(const Scene &scene) {
+            size_t trianglesCount = 0u;
+            for (const auto &mesh : scene.getMeshes()) {
+                trianglesCount += mesh.trianglesCount;
+            }
+
+            return std::to_string(trianglesCount) + " " + std::to_string(scene.getInstances().size()) + " " + std::to_string(scene.getLights().size());
+        }
+
+        template <typename T, typename Allocator>
+        bool uploadElements(DeviceBuffer &buffer, const std::vector<T, Allocator> &elements, const DirtyRange &range) {
+            const auto first = range.isEmpty() ? 0u : range.begin;
+            const auto last = range.isEmpty() ? 0u : range.end;
+            return buffer.upload(elements.data(), elements.size() * sizeof(T), first * sizeof(T), (last - first) * sizeof(T));
+        }
 
     } // namespace
 
-    PathTracer::PathTracer(const NOX::Camera &camera, const Scene &scene) : m_camera(&camera),
-                                                                            m_scene(&scene) {
+    PathTracer::PathTracer(const NOX::Camera &camera, Scene &scene, const KernelProgramSettings &programSettings) : m_camera(&camera),
+                                                                                                                    m_scene(&scene),
+                                                                                                                    m_programSettings(programSettings) {
         auto &application = *NOX::Application::get();
         auto &assetManager = application.getAssetManager();
         const auto &window = application.getWindow();
 
         m_outputTexture = assetManager.loadAssetImmediate<NOX::Texture2D>("outputTexture", window.getWidth(), window.getHeight());
 
-        m_pathTracingProgram = assetManager.loadAssetImmediate<NOX::ComputeProgram>("pathTracingProgram", "assets/kernels/path_tracing.cl");
-        m_generatePrimaryRayKernel = &m_pathTracingProgram->getKernel("generate_primary_ray");
-        m_tracePathKernel = &m_pathTracingProgram->getKernel("trace_path");
-        m_computePixelKernel = &m_pathTracingProgram->getKernel("compute_pixel");
+        m_pathTracingProgram = assetManager.loadAssetImmediate<NOX::ComputeProgram>("pathTracingProgram", m_programSettings.path);
+        m_generatePrimaryRayKernel = &m_pathTracingProgram->getKernel(s_generatePrimaryRayKernelName);
+        m_tracePathKernel = &m_pathTracingProgram->getKernel(s_tracePathKernelName);
+        m_computePixelKernel = &m_pathTracingProgram->getKernel(s_computePixelKernelName);
+        m_prepareDenoiseKernel = &m_pathTracingProgram->getKernel("prepare_denoise");
+        m_denoiseAtrousKernel = &m_pathTracingProgram->getKernel("denoise_atrous");
+        m_computeDenoisedPixelKernel = &m_pathTracingProgram->getKernel("compute_denoised_pixel");
+        m_reprojectHistoryKernel = &m_pathTracingProgram->getKernel("reproject_history");
+        m_drawProgressKernel = &m_pathTracingProgram->getKernel("draw_progress");
+
+        initializeImages();
+        m_drawProgressKernel->setArg(0, *m_outputImage);
     }
 
-    void PathTracer::initialize() {
-        m_bvh.build(m_scene->getTriangles());
+    void PathTracer::startInitialization() {
+        m_memoryTracker.initialize();
+        if (m_memoryTracker.isHostUnifiedMemory()) {
+            m_topLevelNodesBuffer.setZeroCopy(true);
+            m_instancesBuffer.setZeroCopy(true);
+        }
+
+        m_accelerationStructureBuild = std::async(std::launch::async, [this] {
+            m_accelerationStructure.build(*m_scene);
+        });
 
-        initializeImages();
         initializeBuffers();
         initializeGeneratePrimaryRayKernel();
-        initializeTracePathKernel();
+    }
+
+    bool PathTracer::isInitializationReady() const {
+        return !m_accelerationStructureBuild.valid() || m_accelerationStructureBuild.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+    }
+
+    void PathTracer::finishInitialization() {
+        if (m_accelerationStructureBuild.valid()) {
+            m_accelerationStructureBuild.get();
+        }
+
+        updateScene();
         initializeComputePixelKernel();
+        initializeDenoiseKernels();
+        bindAccumulationBuffers();
+        m_memoryTracker.log();
+
+        m_kernelTuner.initialize(m_kernelTuningSettings.profilePath, getSceneKey(*m_scene));
+        tuneKernels(false);
     }
 
-    void PathTracer::reset() {
-        m_sampleCount = 1u;
-        NOX::Compute::enqueueFillBuffer(*m_radianceBuffer, &s_radianceFillPattern, s_radianceValueSize, s_globalWorkSize1D * s_radianceValueSize);
+    void PathTracer::tuneKernels(bool isForced) {
+        if (!m_kernelTuningSettings.enabled) {
+            return;
+        }
+
+        if (isForced) {
+            m_kernelTuner.initialize(m_kernelTuningSettings.profilePath, getSceneKey(*m_scene));
+        }
+
+        for (const auto *kernelName : {s_generatePrimaryRayKernelName, s_tracePathKernelName, s_computePixelKernelName}) {
+            if (isForced || !m_kernelTuner.isTuned(kernelName)) {
+                m_kernelTuner.tune(kernelName, s_globalWorkSize2D, m_kernelTuningSettings.iterations);
+            }
+        }
     }
 
-    void PathTracer::initializeImages() {
-        m_outputImage = NOX::Compute::createImage(NOX::MemoryUsage::READ_WRITE, *m_outputTexture);
+    void PathTracer::setPathSettings(const PathSettings &settings) {
+        m_pathSettings = settings;
+        m_pathSettings.pathStepsBudget = std::max(settings.pathStepsBudget, settings.maxBounces + 1u);
+
+        m_tracePathKernel->setArg(10, &m_pathSettings.maxBounces, sizeof(cl_uint));
+        m_tracePathKernel->setArg(11, &m_pathSettings.pathStepsBudget, sizeof(cl_uint));
+        reset();
     }
 
-    void PathTracer::initializeBuffers() {
-        constexpr size_t raySize = sizeof(cl_float3) * 2;
-        m_primaryRaysBuffer = NOX::Compute::createBuffer(NOX::MemoryUsage::READ_WRITE, s_globalWorkSize1D * raySize);
+    void PathTracer::setNodeLayout(const BVHNodeLayout layout) {
+        if (layout == m_accelerationStructure.getNodeLayout()) {
+            return;
+        }
+
+        m_accelerationStructure.setNodeLayout(layout);
+        m_isAccelerationStructureInvalidated = true;
+        updateScene();
 
-        m_radianceBuffer = NOX::Compute::createBuffer(NOX::MemoryUsage::READ_WRITE, s_globalWorkSize1D * s_radianceValueSize);
-        NOX::Compute::enqueueFillBuffer(*m_radianceBuffer, &s_radianceFillPattern, s_radianceValueSize, s_globalWorkSize1D * s_radianceValueSize);
+        std::cout << "BVH node layout: " << (layout == BVHNodeLayout::TREELET ? "treelet" : "depth-first") << std::endl;
+        resetStatistics();
+    }
+
+    void PathTracer::setBVHOptimizationSettings(const BVHOptimizationSettings &settings) {
+        m_bvhOptimizationSettings = settings;
+        m_accelerationStructure.setOptimizationBudget(std::chrono::milliseconds(settings.enabled ? settings.timeBudget : 0u));
+        m_isAccelerationStructureInvalidated = true;
+        updateScene();
+
+        std::cout << "BVH optimization: " << (settings.enabled ? "enabled" : "disabled") << std::endl;
+        resetStatistics();
+    }
+
+    cl_uint2 PathTracer::getImageSize() const {
+        return {static_cast<cl_uint>(s_globalWorkSize2D[0]), static_cast<cl_uint>(s_globalWorkSize2D[1])};
+    }
+
+    void PathTracer::reset() {
+        m_isHistoryInvalidated = false;
+        clearAccumulationBuffers(m_accumulationBuffers[m_accumulationIndex], s_globalWorkSize1D);
+        clearPathStates(*m_deferredPathsBuffer, *m_sampleCountsBuffer, s_globalWorkSize1D);
+    }
+
+    void PathTracer::invalidateHistory() {
+        if (m_reprojectionSettings.enabled) {
+            m_isHistoryInvalidated = true;
+        } else {
+            reset();
+        }
+    }
 
-        const auto &bvhNodes = m_bvh.getBvhNodes();
-        m_bvhNodesBuffer = NOX::Compute::createBuffer(NOX::MemoryUsage::READ_ONLY | NOX::MemoryUsage::COPY_HOST_PTR, bvhNodes.size() * sizeof(KernelTypes::BVHNode), bvhNodes.data());
+    void PathTracer::drawProgress(float progress) {
+        m_drawProgressKernel->setArg(1, &progress, sizeof(cl_float));
 
-        const auto &triangles = m_bvh.getOrderedTriangles();
-        m_trianglesBuffer = NOX::Compute::createBuffer(NOX::MemoryUsage::READ_ONLY | NOX::MemoryUsage::COPY_HOST_PTR, triangles.size() * sizeof(KernelTypes::Triangle), triangles.data());
+        NOX::Compute::enqueueAcquireGLObject(*m_outputImage);
+        NOX::Compute::enqueueNDRangeKernel(*m_drawProgressKernel, 2, s_globalWorkSize2D);
+        NOX::Compute::enqueueReleaseGLObject(*m_outputImage);
+    }
 
-        const auto &lights = m_scene->getLights();
-        m_lightsBuffer = NOX::Compute::createBuffer(NOX::MemoryUsage::READ_ONLY | NOX::MemoryUsage::COPY_HOST_PTR, lights.size() * sizeof(KernelTypes::Light), lights.data());
+    void PathTracer::initializeImages() {
+        m_outputImage = NOX::Compute::createImage(NOX::MemoryUsage::READ_WRITE, *m_outputTexture);
+    }
 
-        const auto &materials = m_scene->getMaterials();
-        m_materialsBuffer = NOX::Compute::createBuffer(NOX::MemoryUsage::READ_ONLY | NOX::MemoryUsage::COPY_HOST_PTR, materials.size() * sizeof(KernelTypes::Material), materials.data());
+    void PathTracer::initializeBuffers() {
+        const auto raysSize = s_globalWorkSize1D * (s_raySize + s_pathStateSize + s_sampleCountSize);
+        const auto accumulationValuesSize = s_globalWorkSize1D * s_accumulationValueSize;
+        const auto accumulationSetSize = s_accumulationBuffersCount * accumulationValuesSize;
+        const auto denoiseSize = m_denoiseBuffers.size() * accumulationValuesSize;
+
+        auto requiredSize = raysSize + accumulationSetSize + std::min(estimateSceneMemory(*m_scene), m_geometryCache.getMemoryLimit());
+        m_isReprojectionAvailable = m_memoryTracker.canAllocate(requiredSize + accumulationSetSize);
+        requiredSize += m_isReprojectionAvailable ? accumulationSetSize : 0u;
+        m_isDenoiserAvailable = m_memoryTracker.canAllocate(requiredSize + denoiseSize);
+        m_reprojectionSettings.enabled &= m_isReprojectionAvailable;
+        m_denoiserSettings.enabled &= m_isDenoiserAvailable;
+
+        m_primaryRaysBuffer = m_memoryTracker.createBuffer(DeviceMemoryCategory::RAYS, NOX::MemoryUsage::READ_WRITE, s_globalWorkSize1D * s_raySize);
+        m_deferredPathsBuffer = m_memoryTracker.createBuffer(DeviceMemoryCategory::RAYS, NOX::MemoryUsage::READ_WRITE, s_globalWorkSize1D * s_pathStateSize);
+        m_sampleCountsBuffer = m_memoryTracker.createBuffer(DeviceMemoryCategory::RAYS, NOX::MemoryUsage::READ_WRITE, s_globalWorkSize1D * s_sampleCountSize);
+        if (m_programSettings.isRayCounterEnabled) {
+            m_rayCounterBuffer = m_memoryTracker.createBuffer(DeviceMemoryCategory::RAYS, NOX::MemoryUsage::READ_WRITE, sizeof(cl_uint));
+        }
+        resetStatistics();
+
+        const auto accumulationSetsCount = m_isReprojectionAvailable ? m_accumulationBuffers.size() : 1u;
+        for (size_t i = 0; i < accumulationSetsCount; i++) {
+            auto &accumulationBuffers = m_accumulationBuffers[i];
+            accumulationBuffers.radiance = m_memoryTracker.createBuffer(DeviceMemoryCategory::ACCUMULATION, NOX::MemoryUsage::READ_WRITE, accumulationValuesSize);
+            accumulationBuffers.albedo = m_memoryTracker.createBuffer(DeviceMemoryCategory::ACCUMULATION, NOX::MemoryUsage::READ_WRITE, accumulationValuesSize);
+            accumulationBuffers.normalDepth = m_memoryTracker.createBuffer(DeviceMemoryCategory::ACCUMULATION, NOX::MemoryUsage::READ_WRITE, accumulationValuesSize);
+            clearAccumulationBuffers(accumulationBuffers, s_globalWorkSize1D);
+        }
+
+        if (m_isDenoiserAvailable) {
+            for (auto &denoiseBuffer : m_denoiseBuffers) {
+                denoiseBuffer = m_memoryTracker.createBuffer(DeviceMemoryCategory::DENOISE, NOX::MemoryUsage::READ_WRITE, accumulationValuesSize);
+            }
+        }
     }
 
     void PathTracer::initializeGeneratePrimaryRayKernel() {
-        const auto &position = m_camera->getPosition();
-        const auto &forward = m_camera->getForwardVector();
-        const auto &right = m_camera->getRightVector();
-        const auto &up = m_camera->getUpVector();
         const auto &cameraSpecification = m_camera->getSpecification();
-        const auto &fov = glm::tan(glm::radians(cameraSpecification.fov) * 0.5f);
-        const auto &width = static_cast<cl_float>(m_outputTexture->getWidth());
-        const auto &height = static_cast<cl_float>(m_outputTexture->getHeight());
-        const auto &aspectRatio = cameraSpecification.aspectRatio;
-
-        m_generatePrimaryRayKernel->setArg(0, &position, sizeof(cl_float3));
-        m_generatePrimaryRayKernel->setArg(1, &forward, sizeof(cl_float3));
-        m_generatePrimaryRayKernel->setArg(2, &right, sizeof(cl_float3));
-        m_generatePrimaryRayKernel->setArg(3, &up, sizeof(cl_float3));
-        m_generatePrimaryRayKernel->setArg(4, &fov, sizeof(cl_float));
-        m_generatePrimaryRayKernel->setArg(5, &width, sizeof(cl_float));
-        m_generatePrimaryRayKernel->setArg(6, &height, sizeof(cl_float));
-        m_generatePrimaryRayKernel->setArg(7, &aspectRatio, sizeof(cl_float));
-        m_generatePrimaryRayKernel->setArg(8, &m_sampleCount, sizeof(cl_uint));
-        m_generatePrimaryRayKernel->setArg(9, *m_primaryRaysBuffer);
+        m_cameraData.fov = glm::tan(glm::radians(cameraSpecification.fov) * 0.5f);
+        m_cameraData.aspectRatio = cameraSpecification.aspectRatio;
+        m_cameraData.width = static_cast<cl_float>(m_outputTexture->getWidth());
+        m_cameraData.height = static_cast<cl_float>(m_outputTexture->getHeight());
+        updateCameraData();
+        m_previousCameraData = m_cameraData;
+
+        constexpr cl_uint2 tileOffset = {0u, 0u};
+        m_generatePrimaryRayKernel->setArg(0, &m_cameraData, sizeof(KernelTypes::Camera));
+        m_generatePrimaryRayKernel->setArg(1, &tileOffset, sizeof(cl_uint2));
+        m_generatePrimaryRayKernel->setArg(2, &s_interactiveSampleIndexOffset, sizeof(cl_uint));
+        m_generatePrimaryRayKernel->setArg(3, *m_primaryRaysBuffer);
+        m_generatePrimaryRayKernel->setArg(4, *m_sampleCountsBuffer);
     }
 
     void PathTracer::initializeTracePathKernel() {
-        const auto &width = m_outputTexture->getWidth();
+        constexpr cl_uint2 tileOffset = {0u, 0u};
         const auto &lightsCount = static_cast<cl_uint>(m_scene->getLights().size());
+        const auto &rectangleLightsCount = static_cast<cl_uint>(m_scene->getRectangleLightsCount());
 
         m_tracePathKernel->setArg(0, *m_primaryRaysBuffer);
-        m_tracePathKernel->setArg(1, *m_bvhNodesBuffer);
-        m_tracePathKernel->setArg(2, *m_trianglesBuffer);
-        m_tracePathKernel->setArg(3, *m_lightsBuffer);
-        m_tracePathKernel->setArg(4, &lightsCount, sizeof(cl_uint));
-        m_tracePathKernel->setArg(5, &s_maxBounces, sizeof(cl_uint));
-        m_tracePathKernel->setArg(6, &m_sampleCount, sizeof(cl_uint));
-        m_tracePathKernel->setArg(7, &width, sizeof(cl_uint));
-        m_tracePathKernel->setArg(8, *m_materialsBuffer);
-        m_tracePathKernel->setArg(9, *m_radianceBuffer);
+        m_tracePathKernel->setArg(1, *m_topLevelNodesBuffer);
+        m_tracePathKernel->setArg(2, *m_instancesBuffer);
+        m_tracePathKernel->setArg(3, m_geometryCache.getMeshesBuffer());
+        m_tracePathKernel->setArg(4, m_geometryCache.getBottomLevelNodesBuffer());
+        m_tracePathKernel->setArg(5, m_geometryCache.getTrianglesBuffer());
+        m_tracePathKernel->setArg(6, *m_lightsBuffer);
+        m_tracePathKernel->setArg(7, *m_lightAliasTableBuffer);
+        m_tracePathKernel->setArg(8, &lightsCount, sizeof(cl_uint));
+        m_tracePathKernel->setArg(9, &rectangleLightsCount, sizeof(cl_uint));
+        m_tracePathKernel->setArg(10, &m_pathSettings.maxBounces, sizeof(cl_uint));
+        m_tracePathKernel->setArg(11, &m_pathSettings.pathStepsBudget, sizeof(cl_uint));
+        m_tracePathKernel->setArg(12, &s_interactiveSampleIndexOffset, sizeof(cl_uint));
+        m_tracePathKernel->setArg(13, &tileOffset, sizeof(cl_uint2));
+        m_tracePathKernel->setArg(14, &m_cameraData, sizeof(KernelTypes::Camera));
+        m_tracePathKernel->setArg(15, *m_materialsBuffer);
+        m_tracePathKernel->setArg(19, m_geometryCache.getMeshRequestsBuffer());
+        m_tracePathKernel->setArg(20, *m_deferredPathsBuffer);
+        m_tracePathKernel->setArg(21, *m_sampleCountsBuffer);
+        if (m_programSettings.isRayCounterEnabled) {
+            m_tracePathKernel->setArg(22, *m_rayCounterBuffer);
+        }
     }
 
     void PathTracer::initializeComputePixelKernel() {
         m_computePixelKernel->setArg(0, *m_outputImage);
-        m_computePixelKernel->setArg(1, *m_radianceBuffer);
-        m_computePixelKernel->setArg(2, &m_sampleCount, sizeof(cl_uint));
+    }
+
+    void PathTracer::initializeDenoiseKernels() {
+        if (!m_isDenoiserAvailable) {
+            return;
+        }
+
+        m_prepareDenoiseKernel->setArg(2, *m_denoiseBuffers[0]);
+        m_computeDenoisedPixelKernel->setArg(0, *m_outputImage);
+    }
+
+    void PathTracer::updateScene() {
+        const auto &changes = m_scene->getChanges();
+        auto isRebindRequired = false;
+
+        if (changes.isEmissionChanged) {
+            for (uint32_t meshIndex = 0u; meshIndex < m_scene->getMeshes().size(); meshIndex++) {
+                const auto &mesh = m_scene->getMeshes()[meshIndex];
+                const KernelTypes::Triangle *triangles = mesh.triangles.data();
+                auto trianglesCount = mesh.triangles.size();
+                if (trianglesCount == 0u) {
+                    m_accelerationStructure.getMeshTriangles(meshIndex, triangles, trianglesCount);
+                }
+
+                m_scene->updateEmissiveTriangles(meshIndex, triangles, trianglesCount);
+            }
+            m_scene->rebuildTriangleLights();
+        }
+
+        if (changes.isGeometryChanged || changes.areInstancesChanged || m_isAccelerationStructureInvalidated) {
+            if (m_memoryTracker.isHostUnifiedMemory()) {
+                NOX::Compute::finish();
+            }
+
+            auto firstChangedChunk = m_accelerationStructure.getChunks().size();
+            if (m_isAccelerationStructureInvalidated) {
+                firstChangedChunk = 0u;
+                m_accelerationStructure.build(*m_scene);
+                m_isAccelerationStructureInvalidated = false;
+            } else {
+                m_accelerationStructure.update(*m_scene);
+            }
+
+            if (m_bvhOptimizationSettings.enabled) {
+                std::cout << "BVH SAH cost: " << m_accelerationStructure.getInitialCost() << " -> " << m_accelerationStructure.getCost() << std::endl;
+            }
+
+            const auto &topLevelNodes = m_accelerationStructure.getTopLevelNodes();
+            const auto &instances = m_accelerationStructure.getInstances();
+            isRebindRequired |= m_geometryCache.update(m_accelerationStructure, firstChangedChunk);
+            isRebindRequired |= uploadElements(m_topLevelNodesBuffer, topLevelNodes, {0u, topLevelNodes.size()});
+            isRebindRequired |= uploadElements(m_instancesBuffer, instances, {0u, instances.size()});
+            m_scene->releaseTriangles();
+        }
+
+        if (!changes.lights.isEmpty() || changes.isLightsCountChanged) {
+            const auto &lights = m_scene->getLights();
+            m_lightSampler.build(lights);
+
+            const auto &lightAliasTable = m_lightSampler.getAliasTable();
+            uploadElements(m_lightsBuffer, lights, changes.lights);
+            uploadElements(m_lightAliasTableBuffer, lightAliasTable, {0u, lightAliasTable.size()});
+            isRebindRequired = true;
+        }
+
+        if (!changes.materials.isEmpty()) {
+            isRebindRequired |= uploadElements(m_materialsBuffer, m_scene->getMaterials(), changes.materials);
+        }
+
+        if (isRebindRequired) {
+            initializeTracePathKernel();
+            m_memoryTracker.log();
+        }
+
+        m_scene->clearChanges();
+        reset();
     }
 
     void PathTracer::updateCameraData() {
-        const auto &position = m_camera->getPosition();
-        const auto &forward = m_camera->getForwardVector();
-        const auto &right = m_camera->getRightVector();
-        const auto &up = m_camera->getUpVector();
+        setCameraVector(m_cameraData.position, m_camera->getPosition());
+        setCameraVector(m_cameraData.forward, m_camera->getForwardVector());
+        setCameraVector(m_cameraData.right, m_camera->getRightVector());
+        setCameraVector(m_cameraData.up, m_camera->getUpVector());
+
+        m_generatePrimaryRayKernel->setArg(0, &m_cameraData, sizeof(KernelTypes::Camera));
+        m_tracePathKernel->setArg(14, &m_cameraData, sizeof(KernelTypes::Camera));
+    }
+
+    void PathTracer::updateStatistics() {
+        m_statisticsFramesCount++;
+
+        const auto currentTime = std::chrono::steady_clock::now();
+        const auto elapsedTime = std::chrono::duration<float>(currentTime - m_statisticsStartTime).count();
+        if (elapsedTime < s_statisticsInterval) {
+            return;
+        }
+
+        m_statistics.frameTime = elapsedTime / static_cast<float>(m_statisticsFramesCount);
+        std::cout << "Frame time: " << m_statistics.frameTime * 1000.0f << " ms, ";
+        if (m_programSettings.isRayCounterEnabled) {
+            cl_uint raysCount = 0u;
+            NOX::Compute::enqueueReadBuffer(*m_rayCounterBuffer, 0u, sizeof(cl_uint), &raysCount);
+            m_statistics.megaraysPerSecond = static_cast<float>(raysCount) / elapsedTime * 1e-6f;
+            std::cout << m_statistics.megaraysPerSecond << " Mrays/s, ";
+        }
+        std::cout << m_accelerationStructure.getTrianglesCount() << " triangles, " << m_accelerationStructure.getInstances().size() << " instances, "
+                  << m_geometryCache.getResidentChunksCount() << "/" << m_accelerationStructure.getChunks().size() << " chunks resident" << std::endl;
+
+        resetStatistics();
+    }
+
+    void PathTracer::resetStatistics() {
+        if (m_programSettings.isRayCounterEnabled) {
+            NOX::Compute::enqueueFillBuffer(*m_rayCounterBuffer, &s_rayCounterFillPattern, sizeof(cl_uint), sizeof(cl_uint));
+        }
+        m_statisticsFramesCount = 0u;
+        m_statisticsStartTime = std::chrono::steady_clock::now();
+    }
 
-        m_generatePrimaryRayKernel->setArg(0, &position, sizeof(cl_float3));
-        m_generatePrimaryRayKernel->setArg(1, &forward, sizeof(cl_float3));
-        m_generatePrimaryRayKernel->setArg(2, &right, sizeof(cl_float3));
-        m_generatePrimaryRayKernel->setArg(3, &up, sizeof(cl_float3));
+    void PathTracer::bindAccumulationBuffers() {
+        const auto &accumulationBuffers = m_accumulationBuffers[m_accumulationIndex];
+
+        m_tracePathKernel->setArg(16, *accumulationBuffers.radiance);
+        m_tracePathKernel->setArg(17, *accumulationBuffers.albedo);
+        m_tracePathKernel->setArg(18, *accumulationBuffers.normalDepth);
+
+        m_computePixelKernel->setArg(1, *accumulationBuffers.radiance);
+
+        m_prepareDenoiseKernel->setArg(0, *accumulationBuffers.radiance);
+        m_prepareDenoiseKernel->setArg(1, *accumulationBuffers.albedo);
+        m_computeDenoisedPixelKernel->setArg(2, *accumulationBuffers.albedo);
+    }
+
+    void PathTracer::clearAccumulationBuffers(const AccumulationBuffers &buffers, size_t pixelsCount) {
+        NOX::Compute::enqueueFillBuffer(*buffers.radiance, &s_accumulationFillPattern, s_accumulationValueSize, pixelsCount * s_accumulationValueSize);
+        NOX::Compute::enqueueFillBuffer(*buffers.albedo, &s_accumulationFillPattern, s_accumulationValueSize, pixelsCount * s_accumulationValueSize);
+        NOX::Compute::enqueueFillBuffer(*buffers.normalDepth, &s_accumulationFillPattern, s_accumulationValueSize, pixelsCount * s_accumulationValueSize);
     }
 
-    void PathTracer::updateSampleCount() {
-        m_sampleCount++;
+    void PathTracer::clearPathStates(const NOX::ComputeBuffer &deferredPathsBuffer, const NOX::ComputeBuffer &sampleCountsBuffer, size_t pixelsCount) {
+        NOX::Compute::enqueueFillBuffer(deferredPathsBuffer, &s_deferredPathFillPattern, sizeof(cl_uint), pixelsCount * s_pathStateSize);
+        NOX::Compute::enqueueFillBuffer(sampleCountsBuffer, &s_sampleCountFillPattern, s_sampleCountSize, pixelsCount * s_sampleCountSize);
+    }
+
+    void PathTracer::reprojectHistory() {
+        const auto &accumulationBuffers = m_accumulationBuffers[m_accumulationIndex];
+        const auto &historyBuffers = m_accumulationBuffers[m_accumulationIndex ^ 1u];
+
+        const auto maxHistorySamples = static_cast<cl_float>(m_reprojectionSettings.maxHistorySamples);
+        const auto depthThreshold = static_cast<cl_float>(m_reprojectionSettings.depthThreshold);
+        const auto normalThreshold = static_cast<cl_float>(m_reprojectionSettings.normalThreshold);
+
+        m_reprojectHistoryKernel->setArg(0, &m_cameraData, sizeof(KernelTypes::Camera));
+        m_reprojectHistoryKernel->setArg(1, &m_previousCameraData, sizeof(KernelTypes::Camera));
+        m_reprojectHistoryKernel->setArg(2, *accumulationBuffers.radiance);
+        m_reprojectHistoryKernel->setArg(3, *accumulationBuffers.albedo);
+        m_reprojectHistoryKernel->setArg(4, *accumulationBuffers.normalDepth);
+        m_reprojectHistoryKernel->setArg(5, *historyBuffers.radiance);
+        m_reprojectHistoryKernel->setArg(6, *historyBuffers.albedo);
+        m_reprojectHistoryKernel->setArg(7, *historyBuffers.normalDepth);
+        m_reprojectHistoryKernel->setArg(8, &maxHistorySamples, sizeof(cl_float));
+        m_reprojectHistoryKernel->setArg(9, &depthThreshold, sizeof(cl_float));
+        m_reprojectHistoryKernel->setArg(10, &normalThreshold, sizeof(cl_float));
+        NOX::Compute::enqueueNDRangeKernel(*m_reprojectHistoryKernel, 2, s_globalWorkSize2D);
+    }
 
-        m_generatePrimaryRayKernel->setArg(8, &m_sampleCount, sizeof(cl_uint));
-        m_tracePathKernel->setArg(6, &m_sampleCount, sizeof(cl_uint));
-        m_computePixelKernel->setArg(2, &m_sampleCount, sizeof(cl_uint));
+    void PathTracer::denoise() {
+        NOX::Compute::enqueueNDRangeKernel(*m_prepareDenoiseKernel, 2, s_globalWorkSize2D);
+
+        const auto colorPhi = static_cast<cl_float>(m_denoiserSettings.colorPhi);
+        const auto normalPhi = static_cast<cl_float>(m_denoiserSettings.normalPhi);
+        const auto depthPhi = static_cast<cl_float>(m_denoiserSettings.depthPhi);
+        m_denoiseAtrousKernel->setArg(2, *m_accumulationBuffers[m_accumulationIndex].normalDepth);
+        m_denoiseAtrousKernel->setArg(5, &normalPhi, sizeof(cl_float));
+        m_denoiseAtrousKernel->setArg(6, &depthPhi, sizeof(cl_float));
+
+        for (uint32_t i = 0u; i < m_denoiserSettings.iterations; i++) {
+            const auto stepWidth = static_cast<cl_uint>(1u << i);
+            const auto iterationColorPhi = colorPhi / static_cast<cl_float>(stepWidth);
+
+            m_denoiseAtrousKernel->setArg(0, *m_denoiseBuffers[i % 2u]);
+            m_denoiseAtrousKernel->setArg(1, *m_denoiseBuffers[(i + 1u) % 2u]);
+            m_denoiseAtrousKernel->setArg(3, &stepWidth, sizeof(cl_uint));
+            m_denoiseAtrousKernel->setArg(4, &iterationColorPhi, sizeof(cl_float));
+            NOX::Compute::enqueueNDRangeKernel(*m_denoiseAtrousKernel, 2, s_globalWorkSize2D);
+        }
+
+        m_computeDenoisedPixelKernel->setArg(1, *m_denoiseBuffers[m_denoiserSettings.iterations % 2u]);
+        NOX::Compute::enqueueNDRangeKernel(*m_computeDenoisedPixelKernel, 2, s_globalWorkSize2D);
     }
 
     void PathTracer::onUpdate() {
+        if (m_tiledRender != nullptr) {
+            updateTiledRender();
+            return;
+        }
+
+        if (m_scene->getChanges().hasChanges()) {
+            updateScene();
+        }
+
+        m_geometryCache.processRequests(m_accelerationStructure);
         updateCameraData();
-        updateSampleCount();
 
-        NOX::Compute::enqueueNDRangeKernel(*m_generatePrimaryRayKernel, 2, s_globalWorkSize2D);
-        NOX::Compute::enqueueNDRangeKernel(*m_tracePathKernel, 2, s_globalWorkSize2D);
+        const auto isCameraMoved = std::memcmp(&m_cameraData, &m_previousCameraData, sizeof(KernelTypes::Camera)) != 0;
+        const auto isReprojecting = m_isHistoryInvalidated && isCameraMoved;
+        if (isReprojecting) {
+            m_accumulationIndex ^= 1u;
+            bindAccumulationBuffers();
+            clearAccumulationBuffers(m_accumulationBuffers[m_accumulationIndex], s_globalWorkSize1D);
+            clearPathStates(*m_deferredPathsBuffer, *m_sampleCountsBuffer, s_globalWorkSize1D);
+        }
+
+        auto isTuningFinished = m_kernelTuner.launch(s_generatePrimaryRayKernelName, [this](const size_t *localWorkSize) {
+            NOX::Compute::enqueueNDRangeKernel(*m_generatePrimaryRayKernel, 2, s_globalWorkSize2D, localWorkSize);
+        });
+        isTuningFinished |= m_kernelTuner.launch(s_tracePathKernelName, [this](const size_t *localWorkSize) {
+            NOX::Compute::enqueueNDRangeKernel(*m_tracePathKernel, 2, s_globalWorkSize2D, localWorkSize);
+        });
+
+        if (isReprojecting) {
+            reprojectHistory();
+        }
+
+        m_previousCameraData = m_cameraData;
+        m_isHistoryInvalidated = false;
 
         NOX::Compute::enqueueAcquireGLObject(*m_outputImage);
-        NOX::Compute::enqueueNDRangeKernel(*m_computePixelKernel, 2, s_globalWorkSize2D);
+        if (m_denoiserSettings.enabled) {
+            denoise();
+        } else {
+            isTuningFinished |= m_kernelTuner.launch(s_computePixelKernelName, [this](const size_t *localWorkSize) {
+                NOX::Compute::enqueueNDRangeKernel(*m_computePixelKernel, 2, s_globalWorkSize2D, localWorkSize);
+            });
+        }
         NOX::Compute::enqueueReleaseGLObject(*m_outputImage);
+
+        if (isTuningFinished) {
+            m_kernelTuner.saveProfile();
+            resetStatistics();
+            return;
+        }
+
+        updateStatistics();
+    }
+
+    void PathTracer::renderTiled(const TiledRenderSettings &settings) {
+        if (m_tiledRender != nullptr) {
+            std::cout << "Tiled render: already rendering" << std::endl;
+            return;
+        }
+
+        auto tileWriter = std::make_unique<TileWriter>(settings.outputPath, settings.width, settings.height);
+        if (!tileWriter->isOpen()) {
+            return;
+        }
+
+        auto tileWidth = settings.tileWidth;
+        auto tileHeight = settings.tileHeight;
+        const auto canAllocateTile = [this](size_t tilePixelsCount) {
+            return m_memoryTracker.canAllocate(tilePixelsCount * std::max({s_raySize, s_pathStateSize, s_accumulationValueSize})) &&
+                   m_memoryTracker.canAllocate(tilePixelsCount * (s_raySize + s_pathStateSize + s_sampleCountSize + s_accumulationBuffersCount * s_accumulationValueSize));
+        };
+        while (!canAllocateTile(static_cast<size_t>(tileWidth) * tileHeight) && (tileWidth > s_minimumTileSize || tileHeight > s_minimumTileSize)) {
+            if (tileWidth >= tileHeight) {
+                tileWidth = std::max(tileWidth / 2u, s_minimumTileSize);
+            } else {
+                tileHeight = std::max(tileHeight / 2u, s_minimumTileSize);
+            }
+        }
+
+        m_tiledRender = std::make_unique<TiledRender>();
+        auto &tiledRender = *m_tiledRender;
+        tiledRender.settings = settings;
+        tiledRender.tileWriter = std::move(tileWriter);
+        tiledRender.tileWidth = tileWidth;
+        tiledRender.tileHeight = tileHeight;
+        tiledRender.pathStepsBudget = static_cast<cl_uint>(m_pathSettings.maxBounces + 1u);
+
+        const auto tilePixelsCount = static_cast<size_t>(tileWidth) * tileHeight;
+        tiledRender.raysBuffer = m_memoryTracker.createBuffer(DeviceMemoryCategory::RAYS, NOX::MemoryUsage::READ_WRITE, tilePixelsCount * s_raySize);
+        tiledRender.deferredPathsBuffer = m_memoryTracker.createBuffer(DeviceMemoryCategory::RAYS, NOX::MemoryUsage::READ_WRITE, tilePixelsCount * s_pathStateSize);
+        tiledRender.sampleCountsBuffer = m_memoryTracker.createBuffer(DeviceMemoryCategory::RAYS, NOX::MemoryUsage::READ_WRITE, tilePixelsCount * s_sampleCountSize);
+        tiledRender.accumulationBuffers.radiance = m_memoryTracker.createBuffer(DeviceMemoryCategory::ACCUMULATION, NOX::MemoryUsage::READ_WRITE, tilePixelsCount * s_accumulationValueSize);
+        tiledRender.accumulationBuffers.albedo = m_memoryTracker.createBuffer(DeviceMemoryCategory::ACCUMULATION, NOX::MemoryUsage::READ_WRITE, tilePixelsCount * s_accumulationValueSize);
+        tiledRender.accumulationBuffers.normalDepth = m_memoryTracker.createBuffer(DeviceMemoryCategory::ACCUMULATION, NOX::MemoryUsage::READ_WRITE, tilePixelsCount * s_accumulationValueSize);
+        m_memoryTracker.log();
+
+        tiledRender.camera = m_cameraData;
+        tiledRender.camera.width = static_cast<cl_float>(settings.width);
+        tiledRender.camera.height = static_cast<cl_float>(settings.height);
+        tiledRender.camera.aspectRatio = tiledRender.camera.width / tiledRender.camera.height;
+
+        m_generatePrimaryRayKernel->setArg(0, &tiledRender.camera, sizeof(KernelTypes::Camera));
+        m_generatePrimaryRayKernel->setArg(3, *tiledRender.raysBuffer);
+        m_generatePrimaryRayKernel->setArg(4, *tiledRender.sampleCountsBuffer);
+        m_tracePathKernel->setArg(0, *tiledRender.raysBuffer);
+        m_tracePathKernel->setArg(11, &tiledRender.pathStepsBudget, sizeof(cl_uint));
+        m_tracePathKernel->setArg(14, &tiledRender.camera, sizeof(KernelTypes::Camera));
+        m_tracePathKernel->setArg(16, *tiledRender.accumulationBuffers.radiance);
+        m_tracePathKernel->setArg(17, *tiledRender.accumulationBuffers.albedo);
+        m_tracePathKernel->setArg(18, *tiledRender.accumulationBuffers.normalDepth);
+        m_tracePathKernel->setArg(20, *tiledRender.deferredPathsBuffer);
+        m_tracePathKernel->setArg(21, *tiledRender.sampleCountsBuffer);
+
+        beginTile();
+    }
+
+    void PathTracer::beginTile() {
+        auto &tiledRender = *m_tiledRender;
+        const auto tilePixelsCount = static_cast<size_t>(tiledRender.tileWidth) * tiledRender.tileHeight;
+        const cl_uint2 tileOffset = {tiledRender.tileX, tiledRender.tileY};
+        m_generatePrimaryRayKernel->setArg(1, &tileOffset, sizeof(cl_uint2));
+        m_tracePathKernel->setArg(13, &tileOffset, sizeof(cl_uint2));
+        clearAccumulationBuffers(tiledRender.accumulationBuffers, tilePixelsCount);
+        clearPathStates(*tiledRender.deferredPathsBuffer, *tiledRender.sampleCountsBuffer, tilePixelsCount);
+        tiledRender.sample = 1u;
+    }
+
+    void PathTracer::updateTiledRender() {
+        auto &tiledRender = *m_tiledRender;
+        const auto &settings = tiledRender.settings;
+
+        Tile tile{};
+        tile.x = tiledRender.tileX;
+        tile.y = tiledRender.tileY;
+        tile.width = std::min(tiledRender.tileWidth, settings.width - tile.x);
+        tile.height = std::min(tiledRender.tileHeight, settings.height - tile.y);
+
+        const size_t tileWorkSize[2] = {tile.width, tile.height};
+        const auto lastSample = std::min(tiledRender.sample + std::max(settings.samplesPerUpdate, 1u), settings.samplesPerPixel + 1u);
+        for (; tiledRender.sample < lastSample; tiledRender.sample++) {
+            NOX::Compute::enqueueNDRangeKernel(*m_generatePrimaryRayKernel, 2, tileWorkSize);
+            NOX::Compute::enqueueNDRangeKernel(*m_tracePathKernel, 2, tileWorkSize);
+            m_geometryCache.processRequests(m_accelerationStructure);
+        }
+        NOX::Compute::finish();
+
+        if (tiledRender.sample <= settings.samplesPerPixel) {
+            return;
+        }
+
+        tile.radiance.resize(static_cast<size_t>(tile.width) * tile.height);
+        NOX::Compute::enqueueReadBuffer(*tiledRender.accumulationBuffers.radiance, 0u, tile.radiance.size() * sizeof(cl_float4), tile.radiance.data());
+        tiledRender.tileWriter->write(std::move(tile));
+
+        tiledRender.tileX += tiledRender.tileWidth;
+        if (tiledRender.tileX >= settings.width) {
+            tiledRender.tileX = 0u;
+            tiledRender.tileY += tiledRender.tileHeight;
+        }
+
+        if (tiledRender.tileY >= settings.height) {
+            finishTiledRender();
+            return;
+        }
+
+        std::cout << "Tiled render: " << tiledRender.tileY * settings.width + tiledRender.tileX * std::min(tiledRender.tileHeight, settings.height - tiledRender.tileY) << "/"
+                  << static_cast<size_t>(settings.width) * settings.height << " pixels" << std::endl;
+        beginTile();
+    }
+
+    void PathTracer::finishTiledRender() {
+        m_tiledRender->tileWriter->finish();
+        std::cout << "Tiled render: written to " << m_tiledRender->settings.outputPath << std::endl;
+        m_tiledRender.reset();
+
+        initializeGeneratePrimaryRayKernel();
+        initializeTracePathKernel();
+        bindAccumulationBuffers();
+        reset();
+        resetStatistics();
+    }
+
+    void PathTracer::renderSamples(const KernelTypes::Camera &camera, uint32_t firstSample, uint32_t samplesCount, std::vector<cl_float4> &radiance) {
+        const auto &accumulationBuffers = m_accumulationBuffers[m_accumulationIndex];
+        clearAccumulationBuffers(accumulationBuffers, s_globalWorkSize1D);
+        clearPathStates(*m_deferredPathsBuffer, *m_sampleCountsBuffer, s_globalWorkSize1D);
+
+        const auto sampleIndexOffset = static_cast<cl_uint>(firstSample * m_pathSettings.pathStepsBudget);
+        m_generatePrimaryRayKernel->setArg(0, &camera, sizeof(KernelTypes::Camera));
+        m_generatePrimaryRayKernel->setArg(2, &sampleIndexOffset, sizeof(cl_uint));
+        m_tracePathKernel->setArg(12, &sampleIndexOffset, sizeof(cl_uint));
+        m_tracePathKernel->setArg(14, &camera, sizeof(KernelTypes::Camera));
+        for (auto sample = firstSample; sample < firstSample + samplesCount; sample++) {
+            NOX::Compute::enqueueNDRangeKernel(*m_generatePrimaryRayKernel, 2, s_globalWorkSize2D, m_kernelTuner.getLocalWorkSize(s_generatePrimaryRayKernelName));
+            NOX::Compute::enqueueNDRangeKernel(*m_tracePathKernel, 2, s_globalWorkSize2D, m_kernelTuner.getLocalWorkSize(s_tracePathKernelName));
+            m_geometryCache.processRequests(m_accelerationStructure);
+        }
+
+        radiance.resize(s_globalWorkSize1D);
+        NOX::Compute::enqueueReadBuffer(*accumulationBuffers.radiance, 0u, radiance.size() * sizeof(cl_float4), radiance.data());
+
+        m_generatePrimaryRayKernel->setArg(2, &s_interactiveSampleIndexOffset, sizeof(cl_uint));
+        m_tracePathKernel->setArg(12, &s_interactiveSampleIndexOffset, sizeof(cl_uint));
+        updateCameraData();
+        reset();
+    }
+
+    RenderStatistics PathTracer::benchmark(uint32_t warmupFramesCount, uint32_t framesCount) {
+        if (m_scene->getChanges().hasChanges()) {
+            updateScene();
+        }
+        updateCameraData();
+        reset();
+
+        for (auto frame = 0u; frame < warmupFramesCount + framesCount; frame++) {
+            if (frame == warmupFramesCount) {
+                NOX::Compute::finish();
+                resetStatistics();
+            }
+
+            NOX::Compute::enqueueNDRangeKernel(*m_generatePrimaryRayKernel, 2, s_globalWorkSize2D, m_kernelTuner.getLocalWorkSize(s_generatePrimaryRayKernelName));
+            NOX::Compute::enqueueNDRangeKernel(*m_tracePathKernel, 2, s_globalWorkSize2D, m_kernelTuner.getLocalWorkSize(s_tracePathKernelName));
+            m_geometryCache.processRequests(m_accelerationStructure);
+        }
+        NOX::Compute::finish();
+
+        const auto elapsedTime = std::chrono::duration<float>(std::chrono::steady_clock::now() - m_statisticsStartTime).count();
+        RenderStatistics statistics{};
+        statistics.frameTime = elapsedTime / static_cast<float>(std::max(framesCount, 1u));
+        if (m_programSettings.isRayCounterEnabled) {
+            cl_uint raysCount = 0u;
+            NOX::Compute::enqueueReadBuffer(*m_rayCounterBuffer, 0u, sizeof(cl_uint), &raysCount);
+            statistics.megaraysPerSecond = static_cast<float>(raysCount) / elapsedTime * 1e-6f;
+        }
+
+        reset();
+        resetStatistics();
+        return statistics;
     }
 
 } // namespace NOXPT
@@ -1,7 +1,13 @@
 #pragma once
 
-#include "bvh.h"
+#include "acceleration_structure.h"
+#include "device_buffer.h"
+#include "device_memory_tracker.h"
+#include "geometry_cache.h"
+#include "kernel_tuner.h"
+#include "light_sampler.h"
 #include "scene.h"
+#include "tile_writer.h"
 
 #include <nox/compute/compute_buffer.h>
 #include <nox/compute/compute_image.h>
@@ -11,18 +17,132 @@
 
 #include <nox/renderer/texture.h>
 
+#include <include/config.h>
+
+#include <array>
+#include <chrono>
+#include <future>
+#include <memory>
+#include <string>
+
 namespace NOXPT {
 
+    struct PathSettings {
+        uint32_t maxBounces{16u};
+        uint32_t pathStepsBudget{64u};
+    };
+
+    struct DenoiserSettings {
+        bool enabled{true};
+        uint32_t iterations{5u};
+        float colorPhi{0.5f};
+        float normalPhi{64.0f};
+        float depthPhi{0.1f};
+    };
+
+    struct ReprojectionSettings {
+        bool enabled{true};
+        float maxHistorySamples{32.0f};
+        float depthThreshold{0.05f};
+        float normalThreshold{0.9f};
+    };
+
+    struct TiledRenderSettings {
+        uint32_t width{15360u};
+        uint32_t height{8640u};
+        uint32_t tileWidth{512u};
+        uint32_t tileHeight{512u};
+        uint32_t samplesPerPixel{256u};
+        uint32_t samplesPerUpdate{8u};
+        std::string outputPath{"render.pfm"};
+    };
+
+    struct KernelTuningSettings {
+        bool enabled{true};
+        uint32_t iterations{8u};
+        std::string profilePath{"kernel_profile.txt"};
+    };
+
+    struct BVHOptimizationSettings {
+        bool enabled{false};
+        uint32_t timeBudget{10000u};
+    };
+
+    struct KernelProgramSettings {
+        std::string path{"assets/kernels/path_tracing.cl"};
+        bool isRayCounterEnabled{RENDER_STATISTICS != 0};
+    };
+
+    struct RenderStatistics {
+        float frameTime{0.0f};
+        float megaraysPerSecond{0.0f};
+    };
+
     class PathTracer {
       public:
-        PathTracer(const NOX::Camera &camera, const Scene &scene);
+        PathTracer(const NOX::Camera &camera, Scene &scene, const KernelProgramSettings &programSettings = {});
 
         const std::shared_ptr<NOX::Texture2D> &getOutputTexture() const { return m_outputTexture; }
-
-        void initialize();
+        const PathSettings &getPathSettings() const { return m_pathSettings; }
+        void setPathSettings(const PathSettings &settings);
+        const DenoiserSettings &getDenoiserSettings() const { return m_denoiserSettings; }
+        void setDenoiserSettings(const DenoiserSettings &settings) {
+            m_denoiserSettings = settings;
+            m_denoiserSettings.enabled &= m_isDenoiserAvailable;
+        }
+        const ReprojectionSettings &getReprojectionSettings() const { return m_reprojectionSettings; }
+        void setReprojectionSettings(const ReprojectionSettings &settings) {
+            m_reprojectionSettings = settings;
+            m_reprojectionSettings.enabled &= m_isReprojectionAvailable;
+        }
+        BVHNodeLayout getNodeLayout() const { return m_accelerationStructure.getNodeLayout(); }
+        void setNodeLayout(const BVHNodeLayout layout);
+        const KernelTuningSettings &getKernelTuningSettings() const { return m_kernelTuningSettings; }
+        void setKernelTuningSettings(const KernelTuningSettings &settings) { m_kernelTuningSettings = settings; }
+
+        const BVHOptimizationSettings &getBVHOptimizationSettings() const { return m_bvhOptimizationSettings; }
+        void setBVHOptimizationSettings(const BVHOptimizationSettings &settings);
+        const KernelTypes::Camera &getCameraData() const { return m_cameraData; }
+        cl_uint2 getImageSize() const;
+        const DeviceMemoryTracker &getMemoryTracker() const { return m_memoryTracker; }
+        const RenderStatistics &getStatistics() const { return m_statistics; }
+
+        void startInitialization();
+        bool isInitializationReady() const;
+        void finishInitialization();
+        void tuneKernels(bool isForced);
         void reset();
+        void invalidateHistory();
+        void drawProgress(float progress);
 
         void onUpdate();
+        bool isRenderingTiles() const { return m_tiledRender != nullptr; }
+        void renderTiled(const TiledRenderSettings &settings);
+        void renderSamples(const KernelTypes::Camera &camera, uint32_t firstSample, uint32_t samplesCount, std::vector<cl_float4> &radiance);
+        RenderStatistics benchmark(uint32_t warmupFramesCount, uint32_t framesCount);
+
+      private:
+        struct AccumulationBuffers {
+            std::shared_ptr<NOX::ComputeBuffer> radiance{nullptr};
+            std::shared_ptr<NOX::ComputeBuffer> albedo{nullptr};
+            std::shared_ptr<NOX::ComputeBuffer> normalDepth{nullptr};
+        };
+
+        struct TiledRender {
+            TiledRenderSettings settings{};
+            std::unique_ptr<TileWriter> tileWriter{nullptr};
+            KernelTypes::Camera camera{};
+            uint32_t tileWidth{0u};
+            uint32_t tileHeight{0u};
+            uint32_t tileX{0u};
+            uint32_t tileY{0u};
+            cl_uint sample{1u};
+            cl_uint pathStepsBudget{0u};
+            std::shared_ptr<NOX::ComputeBuffer> raysBuffer{nullptr};
+            std::shared_ptr<NOX::ComputeBuffer> deferredPathsBuffer{nullptr};
+            std::shared_ptr<NOX::ComputeBuffer> sampleCountsBuffer{nullptr};
+            AccumulationBuffers accumulationBuffers{};
+        };
 
       private:
         void initializeImages();
@@ -30,16 +150,47 @@ namespace NOXPT {
         void initializeGeneratePrimaryRayKernel();
         void initializeTracePathKernel();
         void initializeComputePixelKernel();
+        void initializeDenoiseKernels();
 
       private:
+        void updateScene();
         void updateCameraData();
-        void updateSampleCount();
+        void updateStatistics();
+        void resetStatistics();
+        void bindAccumulationBuffers();
+        void clearAccumulationBuffers(const AccumulationBuffers &buffers, size_t pixelsCount);
+        void clearPathStates(const NOX::ComputeBuffer &deferredPathsBuffer, const NOX::ComputeBuffer &sampleCountsBuffer, size_t pixelsCount);
+
+      private:
+        void reprojectHistory();
+        void denoise();
+        void beginTile();
+        void updateTiledRender();
+        void finishTiledRender();
 
       private:
         const NOX::Camera *m_camera{nullptr};
-        const Scene *m_scene{nullptr};
-        BVH m_bvh{};
-        uint32_t m_sampleCount = 1u;
+        Scene *m_scene{nullptr};
+        KernelProgramSettings m_programSettings{};
+        AccelerationStructure m_accelerationStructure{};
+        bool m_isAccelerationStructureInvalidated{false};
+        LightSampler m_lightSampler{};
+        PathSettings m_pathSettings{};
+        DenoiserSettings m_denoiserSettings{};
+        ReprojectionSettings m_reprojectionSettings{};
+        KernelTuningSettings m_kernelTuningSettings{};
+        BVHOptimizationSettings m_bvhOptimizationSettings{};
+        KernelTuner m_kernelTuner{};
+        bool m_isDenoiserAvailable{true};
+        bool m_isReprojectionAvailable{true};
+
+        KernelTypes::Camera m_cameraData{};
+        KernelTypes::Camera m_previousCameraData{};
+        bool m_isHistoryInvalidated{false};
+
+        RenderStatistics m_statistics{};
+        uint32_t m_statisticsFramesCount{0u};
+        std::chrono::steady_clock::time_point m_statisticsStartTime{};
 
         std::shared_ptr<NOX::ComputeProgram> m_pathTracingProgram{nullptr};
         std::shared_ptr<NOX::Texture2D> m_outputTexture{nullptr};
@@ -47,14 +198,30 @@ namespace NOXPT {
         NOX::ComputeKernel *m_generatePrimaryRayKernel{nullptr};
         NOX::ComputeKernel *m_tracePathKernel{nullptr};
         NOX::ComputeKernel *m_computePixelKernel{nullptr};
-
+        NOX::ComputeKernel *m_prepareDenoiseKernel{nullptr};
+        NOX::ComputeKernel *m_denoiseAtrousKernel{nullptr};
+        NOX::ComputeKernel *m_computeDenoisedPixelKernel{nullptr};
+        NOX::ComputeKernel *m_reprojectHistoryKernel{nullptr};
+        NOX::ComputeKernel *m_drawProgressKernel{nullptr};
+
+        DeviceMemoryTracker m_memoryTracker{};
+        GeometryCache m_geometryCache{m_memoryTracker};
         std::shared_ptr<NOX::ComputeImage> m_outputImage{nullptr};
         std::shared_ptr<NOX::ComputeBuffer> m_primaryRaysBuffer{nullptr};
-        std::shared_ptr<NOX::ComputeBuffer> m_radianceBuffer{nullptr};
-        std::shared_ptr<NOX::ComputeBuffer> m_bvhNodesBuffer{nullptr};
-        std::shared_ptr<NOX::ComputeBuffer> m_trianglesBuffer{nullptr};
-        std::shared_ptr<NOX::ComputeBuffer> m_lightsBuffer{nullptr};
-        std::shared_ptr<NOX::ComputeBuffer> m_materialsBuffer{nullptr};
+        std::shared_ptr<NOX::ComputeBuffer> m_rayCounterBuffer{nullptr};
+        std::shared_ptr<NOX::ComputeBuffer> m_deferredPathsBuffer{nullptr};
+        std::shared_ptr<NOX::ComputeBuffer> m_sampleCountsBuffer{nullptr};
+        std::array<AccumulationBuffers, 2> m_accumulationBuffers{};
+        uint32_t m_accumulationIndex{0u};
+        std::array<std::shared_ptr<NOX::ComputeBuffer>, 2> m_denoiseBuffers{};
+        std::unique_ptr<TiledRender> m_tiledRender{nullptr};
+        DeviceBuffer m_topLevelNodesBuffer{m_memoryTracker, DeviceMemoryCategory::BVH};
+        DeviceBuffer m_instancesBuffer{m_memoryTracker, DeviceMemoryCategory::BVH};
+        DeviceBuffer m_lightsBuffer{m_memoryTracker, DeviceMemoryCategory::LIGHTS};
+        DeviceBuffer m_lightAliasTableBuffer{m_memoryTracker, DeviceMemoryCategory::LIGHTS};
+        DeviceBuffer m_materialsBuffer{m_memoryTracker, DeviceMemoryCategory::MATERIALS};
+
+        std::future<void> m_accelerationStructureBuild{};
     };
 
 } // namespace NOXPT
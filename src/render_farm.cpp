@@ -0,0 +1,308 @@
+#include "render_farm.h"
+#include "path_tracer.h"
+#include "tile_writer.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <thread>
+
+namespace NOXPT {
+
+    namespace {
+
+        constexpr const char *s_workerArgument = "--render-worker";
+        constexpr uint32_t s_pollInterval = 100u;
+        constexpr uint32_t s_handshakeTimeout = 10000u;
+        constexpr auto s_workerExitTimeout = std::chrono::seconds(5);
+
+        struct JobMessage {
+            KernelTypes::Camera camera;
+            cl_uint firstSample;
+            cl_uint samplesCount;
+        };
+
+        struct ResultHeader {
+            cl_uint firstSample;
+            cl_uint samplesCount;
+            cl_uint width;
+            cl_uint height;
+        };
+
+        std::string resolveExecutablePath(const std::string &executablePath) {
+            std::error_code error{};
+#ifdef _WIN32
+            char *modulePath = nullptr;
+            if (_get_pgmptr(&modulePath) == 0 && modulePath != nullptr && *modulePath != '\0') {
+                return modulePath;
+            }
+#else
+            const auto procPath = std::filesystem::read_symlink("/proc/self/exe", error);
+            if (!error) {
+                return procPath.string();
+            }
+#endif
+            const auto absolutePath = std::filesystem::absolute(executablePath, error);
+            return error ? executablePath : absolutePath.string();
+        }
+
+    } // namespace
+
+    RenderFarm::RenderFarm(PathTracer &pathTracer, const std::string &executablePath) : m_pathTracer(&pathTracer),
+                                                                                          m_executablePath(resolveExecutablePath(executablePath)) {}
+
+    RenderFarm::~RenderFarm() {
+        cancel();
+        if (m_coordinator.joinable()) {
+            m_coordinator.join();
+        }
+    }
+
+    void RenderFarm::render(const RenderFarmSettings &settings) {
+        if (m_isRendering) {
+            std::cout << "Render farm: already rendering" << std::endl;
+            return;
+        }
+
+        if (m_coordinator.joinable()) {
+            m_coordinator.join();
+        }
+
+        m_isRendering = true;
+        m_isCancelled = false;
+        m_coordinator = std::thread([this, settings, camera = m_pathTracer->getCameraData()] {
+            coordinate(settings, camera);
+            m_isRendering = false;
+        });
+    }
+
+    void RenderFarm::coordinate(const RenderFarmSettings &settings, const KernelTypes::Camera &camera) {
+        auto listenSocket = LocalSocket::listen(0u);
+        if (!listenSocket.isValid()) {
+            std::cout << "Render farm: failed to open a local socket" << std::endl;
+            return;
+        }
+
+        const auto samplesPerJob = std::max(settings.samplesPerJob, 1u);
+        m_pendingJobs.clear();
+        for (auto firstSample = 0u; firstSample < settings.samplesPerPixel; firstSample += samplesPerJob) {
+            m_pendingJobs.push_back({firstSample + 1u, std::min(samplesPerJob, settings.samplesPerPixel - firstSample)});
+        }
+        m_activeJobsCount = 0u;
+        m_finishedSamplesCount = 0u;
+        m_totalSamplesCount = settings.samplesPerPixel;
+        m_width = 0u;
+        m_height = 0u;
+        m_radiance.clear();
+
+        auto launchedCount = 0u;
+        for (auto i = 0u; i < settings.workersCount; i++) {
+            launchedCount += startWorkerProcess(listenSocket.getPort()) ? 1u : 0u;
+        }
+
+        std::vector<LocalSocket> workerSockets{};
+        std::vector<uint32_t> workerProcessIds{};
+        const auto connectDeadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(settings.connectTimeout);
+        while (workerSockets.size() < launchedCount && !m_isCancelled && std::chrono::steady_clock::now() < connectDeadline) {
+            auto workerSocket = listenSocket.accept(s_pollInterval);
+            cl_uint processId = 0u;
+            if (!workerSocket.isValid() || !workerSocket.setReceiveTimeout(s_handshakeTimeout) || !workerSocket.receive(&processId, sizeof(cl_uint))) {
+                continue;
+            }
+
+            workerSocket.setReceiveTimeout(settings.jobTimeout);
+            workerSockets.push_back(std::move(workerSocket));
+            workerProcessIds.push_back(processId);
+        }
+        listenSocket.close();
+        std::cout << "Render farm: " << workerSockets.size() << "/" << settings.workersCount << " workers connected" << std::endl;
+
+        std::vector<std::thread> workers{};
+        for (size_t i = 0; i < workerSockets.size(); i++) {
+            workers.emplace_back(&RenderFarm::serveWorker, this, std::ref(workerSockets[i]), workerProcessIds[i], std::cref(camera));
+        }
+
+        for (auto &worker : workers) {
+            worker.join();
+        }
+        stopWorkerProcesses();
+
+        if (m_finishedSamplesCount < m_totalSamplesCount || m_radiance.empty()) {
+            std::cout << "Render farm: finished " << m_finishedSamplesCount << "/" << m_totalSamplesCount << " samples, no image written" << std::endl;
+            return;
+        }
+
+        TileWriter tileWriter(settings.outputPath, m_width, m_height, 1u);
+        tileWriter.write({0u, 0u, m_width, m_height, std::move(m_radiance)});
+        tileWriter.finish();
+        std::cout << "Render farm: " << m_totalSamplesCount << " samples written to " << settings.outputPath << std::endl;
+    }
+
+    bool RenderFarm::startWorkerProcess(uint16_t port) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_isCancelled) {
+            return false;
+        }
+
+        auto process = LocalProcess::start(m_executablePath, {s_workerArgument, std::to_string(port)});
+        if (!process.isValid()) {
+            std::cout << "Render farm: failed to start a worker process" << std::endl;
+            return false;
+        }
+
+        m_processes.push_back(std::move(process));
+        return true;
+    }
+
+    void RenderFarm::terminateWorkerProcess(uint32_t processId) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (const auto &process : m_processes) {
+            if (process.getId() == processId) {
+                process.terminate();
+            }
+        }
+    }
+
+    void RenderFarm::stopWorkerProcesses() {
+        const auto exitDeadline = std::chrono::steady_clock::now() + s_workerExitTimeout;
+        while (true) {
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_processes.erase(std::remove_if(m_processes.begin(), m_processes.end(), [](LocalProcess &process) { return process.wait(0u); }), m_processes.end());
+                if (m_processes.empty()) {
+                    return;
+                }
+
+                if (m_isCancelled || std::chrono::steady_clock::now() >= exitDeadline) {
+                    m_processes.clear();
+                    return;
+                }
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(s_pollInterval));
+        }
+    }
+
+    void RenderFarm::cancel() {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_isCancelled = true;
+            for (const auto &process : m_processes) {
+                process.terminate();
+            }
+        }
+        m_condition.notify_all();
+    }
+
+    bool RenderFarm::isWorker(const NOX::ApplicationCommandLineArguments &arguments) {
+        return arguments.count >= 3 && std::string(arguments[1]) == s_workerArgument;
+    }
+
+    bool RenderFarm::runWorker(const NOX::ApplicationCommandLineArguments &arguments) {
+        if (!isWorker(arguments)) {
+            return false;
+        }
+
+        work(static_cast<uint16_t>(std::strtoul(arguments[2], nullptr, 10)));
+        return true;
+    }
+
+    void RenderFarm::work(uint16_t port) {
+        const auto socket = LocalSocket::connect(port);
+        const cl_uint processId = LocalProcess::getCurrentId();
+        if (!socket.isValid() || !socket.send(&processId, sizeof(cl_uint))) {
+            return;
+        }
+
+        std::vector<cl_float4> radiance{};
+        JobMessage jobMessage{};
+        while (socket.receive(&jobMessage, sizeof(JobMessage)) && jobMessage.samplesCount > 0u) {
+            m_pathTracer->renderSamples(jobMessage.camera, jobMessage.firstSample, jobMessage.samplesCount, radiance);
+
+            const auto &imageSize = m_pathTracer->getImageSize();
+            const ResultHeader header{jobMessage.firstSample, jobMessage.samplesCount, imageSize.s[0], imageSize.s[1]};
+            if (!socket.send(&header, sizeof(ResultHeader)) || !socket.send(radiance.data(), radiance.size() * sizeof(cl_float4))) {
+                return;
+            }
+        }
+    }
+
+    void RenderFarm::serveWorker(LocalSocket &socket, uint32_t processId, const KernelTypes::Camera &camera) {
+        std::vector<cl_float4> radiance{};
+        Job job{};
+        while (takeJob(job)) {
+            const JobMessage jobMessage{camera, job.firstSample, job.samplesCount};
+            ResultHeader header{};
+            if (!socket.send(&jobMessage, sizeof(JobMessage)) || !socket.receive(&header, sizeof(ResultHeader)) ||
+                header.firstSample != job.firstSample || header.samplesCount != job.samplesCount) {
+                abandonJob(job);
+                terminateWorkerProcess(processId);
+                socket.close();
+                return;
+            }
+
+            radiance.resize(static_cast<size_t>(header.width) * header.height);
+            if (!socket.receive(radiance.data(), radiance.size() * sizeof(cl_float4))) {
+                abandonJob(job);
+                terminateWorkerProcess(processId);
+                socket.close();
+                return;
+            }
+
+            finishJob(job, radiance, header.width, header.height);
+        }
+
+        const JobMessage stopMessage{camera, 0u, 0u};
+        socket.send(&stopMessage, sizeof(JobMessage));
+        socket.close();
+    }
+
+    bool RenderFarm::takeJob(Job &job) {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_condition.wait(lock, [this] { return !m_pendingJobs.empty() || m_activeJobsCount == 0u || m_isCancelled; });
+        if (m_pendingJobs.empty() || m_isCancelled) {
+            return false;
+        }
+
+        job = m_pendingJobs.front();
+        m_pendingJobs.pop_front();
+        m_activeJobsCount++;
+        return true;
+    }
+
+    void RenderFarm::finishJob(const Job &job, const std::vector<cl_float4> &radiance, uint32_t width, uint32_t height) {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (m_radiance.empty()) {
+                m_width = width;
+                m_height = height;
+                m_radiance.assign(radiance.size(), cl_float4{});
+            }
+
+            if (width == m_width && height == m_height) {
+                for (size_t i = 0; i < radiance.size(); i++) {
+                    for (auto channel = 0; channel < 4; channel++) {
+                        m_radiance[i].s[channel] += radiance[i].s[channel];
+                    }
+                }
+                m_finishedSamplesCount += job.samplesCount;
+            }
+
+            m_activeJobsCount--;
+            std::cout << "Render farm: " << m_finishedSamplesCount << "/" << m_totalSamplesCount << " samples" << std::endl;
+        }
+        m_condition.notify_all();
+    }
+
+    void RenderFarm::abandonJob(const Job &job) {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_pendingJobs.push_front(job);
+            m_activeJobsCount--;
+            std::cout << "Render farm: worker lost, samples " << job.firstSample << "-" << job.firstSample + job.samplesCount - 1u << " reassigned" << std::endl;
+        }
+        m_condition.notify_all();
+    }
+
+} // namespace NOXPT
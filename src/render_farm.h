@@ -0,0 +1,80 @@
+#pragma once
+
+#include "kernel_types.h"
+#include "local_process.h"
+#include "local_socket.h"
+
+#include <CL/cl.h>
+
+#include <nox/application.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace NOXPT {
+
+    class PathTracer;
+
+    struct RenderFarmSettings {
+        uint32_t workersCount{2u};
+        uint32_t samplesPerPixel{1024u};
+        uint32_t samplesPerJob{16u};
+        uint32_t connectTimeout{60000u};
+        uint32_t jobTimeout{600000u};
+        std::string outputPath{"render_farm.pfm"};
+    };
+
+    class RenderFarm {
+      public:
+        RenderFarm(PathTracer &pathTracer, const std::string &executablePath);
+        ~RenderFarm();
+
+        static bool isWorker(const NOX::ApplicationCommandLineArguments &arguments);
+
+        bool isRendering() const { return m_isRendering; }
+        void render(const RenderFarmSettings &settings);
+        bool runWorker(const NOX::ApplicationCommandLineArguments &arguments);
+
+      private:
+        struct Job {
+            cl_uint firstSample{};
+            cl_uint samplesCount{};
+        };
+
+      private:
+        void coordinate(const RenderFarmSettings &settings, const KernelTypes::Camera &camera);
+        void work(uint16_t port);
+        void serveWorker(LocalSocket &socket, uint32_t processId, const KernelTypes::Camera &camera);
+        bool startWorkerProcess(uint16_t port);
+        void terminateWorkerProcess(uint32_t processId);
+        void stopWorkerProcesses();
+        void cancel();
+        bool takeJob(Job &job);
+        void finishJob(const Job &job, const std::vector<cl_float4> &radiance, uint32_t width, uint32_t height);
+        void abandonJob(const Job &job);
+
+      private:
+        PathTracer *m_pathTracer{nullptr};
+        std::string m_executablePath{};
+
+        std::thread m_coordinator{};
+        std::atomic<bool> m_isRendering{false};
+        std::atomic<bool> m_isCancelled{false};
+        std::mutex m_mutex{};
+        std::condition_variable m_condition{};
+        std::vector<LocalProcess> m_processes{};
+        std::deque<Job> m_pendingJobs{};
+        uint32_t m_activeJobsCount{0u};
+        uint32_t m_finishedSamplesCount{0u};
+        uint32_t m_totalSamplesCount{0u};
+        uint32_t m_width{0u};
+        uint32_t m_height{0u};
+        std::vector<cl_float4> m_radiance{};
+    };
+
+} // namespace NOXPT
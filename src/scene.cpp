@@ -4,13 +4,76 @@
 
 #include <nox/renderer/texture.h>
 
+#include <glm/glm.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
 namespace NOXPT {
 
-    void Scene::addModel(const std::shared_ptr<NOX::Model> &model) {
+    namespace {
+
+        glm::vec3 toVec3(const cl_float3 &value) {
+            return {value.s[0], value.s[1], value.s[2]};
+        }
+
+        bool isEmissive(const KernelTypes::Material &material) {
+            return (material.emissive.s[0] > 0.0f) || (material.emissive.s[1] > 0.0f) || (material.emissive.s[2] > 0.0f);
+        }
+
+        KernelTypes::Light createRectangleLight(const NOX::RectangleLight &light) {
+            KernelTypes::Light newLight;
+            std::memcpy(newLight.position.s, glm::value_ptr(glm::vec4(light.getPosition(), 0.0f)), sizeof(cl_float4));
+            std::memcpy(newLight.emission.s, glm::value_ptr(glm::vec4(light.getEmission(), 0.0f)), sizeof(cl_float4));
+            std::memcpy(newLight.u.s, glm::value_ptr(glm::vec4(light.getU(), 0.0f)), sizeof(cl_float4));
+            std::memcpy(newLight.v.s, glm::value_ptr(glm::vec4(light.getV(), 0.0f)), sizeof(cl_float4));
+            newLight.area = light.getArea();
+            newLight.type = static_cast<cl_uint>(KernelTypes::LightType::RECTANGLE);
+
+            return newLight;
+        }
+
+        KernelTypes::Light createTriangleLight(const KernelTypes::Triangle &triangle, const glm::mat4 &transform, const KernelTypes::Material &material) {
+            const auto v0 = glm::vec3(transform * glm::vec4(toVec3(triangle.v0.position), 1.0f));
+            const auto v1 = glm::vec3(transform * glm::vec4(toVec3(triangle.v1.position), 1.0f));
+            const auto v2 = glm::vec3(transform * glm::vec4(toVec3(triangle.v2.position), 1.0f));
+            const auto u = v1 - v0;
+            const auto v = v2 - v0;
+
+            KernelTypes::Light newLight;
+            std::memcpy(newLight.position.s, glm::value_ptr(glm::vec4(v0, 0.0f)), sizeof(cl_float4));
+            newLight.emission = material.emissive;
+            std::memcpy(newLight.u.s, glm::value_ptr(glm::vec4(u, 0.0f)), sizeof(cl_float4));
+            std::memcpy(newLight.v.s, glm::value_ptr(glm::vec4(v, 0.0f)), sizeof(cl_float4));
+            newLight.area = 0.5f * glm::length(glm::cross(u, v));
+            newLight.type = static_cast<cl_uint>(KernelTypes::LightType::TRIANGLE);
+
+            return newLight;
+        }
+
+    } // namespace
+
+    uint32_t Scene::addModel(const std::shared_ptr<NOX::Model> &model, const glm::mat4 &transform) {
+        const auto it = m_modelMeshIndices.find(model.get());
+        const auto meshIndex = (it != m_modelMeshIndices.end()) ? it->second : addMesh(model);
+
+        return addInstance(meshIndex, transform);
+    }
+
+    uint32_t Scene::addModel(ModelData &&model, const glm::mat4 &transform) {
+        return addInstance(addMesh(std::move(model)), transform);
+    }
+
+    uint32_t Scene::addMesh(const std::shared_ptr<NOX::Model> &model) {
+        ModelData modelData{};
+        modelData.materials.reserve(model->getMaterials().size());
+        for (const auto &material : model->getMaterials()) {
+            KernelTypes::Material newMaterial;
+            newMaterial.diffuse = {material.diffuse.x, material.diffuse.y, material.diffuse.z};
+            newMaterial.emissive = {material.emissive.x, material.emissive.y, material.emissive.z};
+            modelData.materials.push_back(newMaterial);
+        }
+
         for (const auto &mesh : model->getMeshes()) {
-            m_triangles.reserve(m_triangles.size() + mesh.vertices.size());
+            modelData.triangles.reserve(modelData.triangles.size() + mesh.vertices.size() / 3);
             for (auto i = 0; i < mesh.vertices.size(); i += 3) {
                 KernelTypes::Triangle triangle;
 
@@ -25,28 +88,140 @@ namespace NOXPT {
 
                 triangle.materialIndex = mesh.materialIndex;
 
-                m_triangles.push_back(triangle);
+                modelData.triangles.push_back(triangle);
             }
         }
 
-        m_materials.reserve(model->getMaterials().size());
-        for (const auto &material : model->getMaterials()) {
-            KernelTypes::Material newMaterial;
-            newMaterial.diffuse = {material.diffuse.x, material.diffuse.y, material.diffuse.z};
-            newMaterial.emissive = {material.emissive.x, material.emissive.y, material.emissive.z};
-            m_materials.push_back(newMaterial);
+        const auto meshIndex = addMesh(std::move(modelData));
+        m_modelMeshIndices[model.get()] = meshIndex;
+
+        return meshIndex;
+    }
+
+    uint32_t Scene::addMesh(ModelData &&model) {
+        const auto materialOffset = static_cast<cl_uint>(m_materials.size());
+        m_materials.insert(m_materials.end(), model.materials.begin(), model.materials.end());
+        m_changes.materials.mark(materialOffset, m_materials.size());
+
+        Mesh newMesh{};
+        newMesh.triangles = std::move(model.triangles);
+        newMesh.trianglesCount = newMesh.triangles.size();
+        for (auto &triangle : newMesh.triangles) {
+            triangle.materialIndex += materialOffset;
+            newMesh.bounds.grow(toVec3(triangle.v0.position));
+            newMesh.bounds.grow(toVec3(triangle.v1.position));
+            newMesh.bounds.grow(toVec3(triangle.v2.position));
+        }
+
+        const auto meshIndex = static_cast<uint32_t>(m_meshes.size());
+        m_meshes.push_back(std::move(newMesh));
+        updateEmissiveTriangles(meshIndex, m_meshes[meshIndex].triangles.data(), m_meshes[meshIndex].triangles.size());
+        m_changes.isGeometryChanged = true;
+
+        return meshIndex;
+    }
+
+    void Scene::updateEmissiveTriangles(const uint32_t meshIndex, const KernelTypes::Triangle *triangles, const size_t trianglesCount) {
+        auto &mesh = m_meshes[meshIndex];
+        mesh.emissiveTriangles.clear();
+        for (size_t i = 0; i < trianglesCount; i++) {
+            const auto &triangle = triangles[i];
+            const auto area = glm::length(glm::cross(toVec3(triangle.v1.position) - toVec3(triangle.v0.position),
+                                                     toVec3(triangle.v2.position) - toVec3(triangle.v0.position)));
+            if (isEmissive(m_materials[triangle.materialIndex]) && area > 0.0f) {
+                mesh.emissiveTriangles.push_back(triangle);
+            }
         }
     }
 
+    void Scene::releaseTriangles() {
+        for (auto &mesh : m_meshes) {
+            mesh.triangles = {};
+        }
+    }
+
+    uint32_t Scene::addInstance(const uint32_t meshIndex, const glm::mat4 &transform) {
+        Instance instance{};
+        instance.meshIndex = meshIndex;
+        instance.transform = transform;
+        instance.lightsOffset = static_cast<uint32_t>(m_lights.size()) - m_rectangleLightsCount;
+
+        m_lights.resize(m_lights.size() + m_meshes[meshIndex].emissiveTriangles.size());
+        m_changes.isLightsCountChanged |= !m_meshes[meshIndex].emissiveTriangles.empty();
+        updateInstanceLights(instance);
+
+        m_instances.push_back(instance);
+        m_changes.areInstancesChanged = true;
+
+        return static_cast<uint32_t>(m_instances.size() - 1u);
+    }
+
+    void Scene::removeInstance(const uint32_t instanceIndex) {
+        const auto &instance = m_instances[instanceIndex];
+        const auto firstLight = m_rectangleLightsCount + instance.lightsOffset;
+        const auto lightsCount = static_cast<uint32_t>(m_meshes[instance.meshIndex].emissiveTriangles.size());
+
+        m_lights.erase(m_lights.begin() + firstLight, m_lights.begin() + firstLight + lightsCount);
+        for (auto i = instanceIndex + 1u; i < m_instances.size(); i++) {
+            m_instances[i].lightsOffset -= lightsCount;
+        }
+
+        m_instances.erase(m_instances.begin() + instanceIndex);
+        m_changes.lights.mark(firstLight, m_lights.size());
+        m_changes.isLightsCountChanged |= lightsCount > 0u;
+        m_changes.areInstancesChanged = true;
+    }
+
+    void Scene::setInstanceTransform(const uint32_t instanceIndex, const glm::mat4 &transform) {
+        auto &instance = m_instances[instanceIndex];
+        instance.transform = transform;
+        updateInstanceLights(instance);
+        m_changes.areInstancesChanged = true;
+    }
+
+    void Scene::updateInstanceLights(const Instance &instance) {
+        const auto &mesh = m_meshes[instance.meshIndex];
+        const auto firstLight = m_rectangleLightsCount + instance.lightsOffset;
+        auto lightIndex = firstLight;
+        for (const auto &triangle : mesh.emissiveTriangles) {
+            m_lights[lightIndex++] = createTriangleLight(triangle, instance.transform, m_materials[triangle.materialIndex]);
+        }
+
+        m_changes.lights.mark(firstLight, lightIndex);
+    }
+
+    void Scene::rebuildTriangleLights() {
+        const auto previousLightsCount = m_lights.size();
+        m_lights.resize(m_rectangleLightsCount);
+        for (auto &instance : m_instances) {
+            instance.lightsOffset = static_cast<uint32_t>(m_lights.size()) - m_rectangleLightsCount;
+            m_lights.resize(m_lights.size() + m_meshes[instance.meshIndex].emissiveTriangles.size());
+            updateInstanceLights(instance);
+        }
+
+        m_changes.lights.mark(m_rectangleLightsCount, m_lights.size());
+        m_changes.isLightsCountChanged |= m_lights.size() != previousLightsCount;
+        m_changes.isEmissionChanged = false;
+    }
+
+    void Scene::setMaterial(const uint32_t materialIndex, const KernelTypes::Material &material) {
+        const auto isEmissionChanged = std::memcmp(&m_materials[materialIndex].emissive, &material.emissive, sizeof(cl_float3)) != 0;
+
+        m_materials[materialIndex] = material;
+        m_changes.materials.mark(materialIndex, materialIndex + 1u);
+        m_changes.isEmissionChanged |= isEmissionChanged;
+    }
+
     void Scene::addRectangleLight(const NOX::RectangleLight &light) {
-        KernelTypes::Light newLight;
-        std::memcpy(newLight.position.s, glm::value_ptr(glm::vec4(light.getPosition(), 0.0f)), sizeof(cl_float4));
-        std::memcpy(newLight.emission.s, glm::value_ptr(glm::vec4(light.getEmission(), 0.0f)), sizeof(cl_float4));
-        std::memcpy(newLight.u.s, glm::value_ptr(glm::vec4(light.getU(), 0.0f)), sizeof(cl_float4));
-        std::memcpy(newLight.v.s, glm::value_ptr(glm::vec4(light.getV(), 0.0f)), sizeof(cl_float4));
-        newLight.area = light.getArea();
-
-        m_lights.push_back(newLight);
+        m_lights.insert(m_lights.begin() + m_rectangleLightsCount, createRectangleLight(light));
+        m_changes.lights.mark(m_rectangleLightsCount, m_lights.size());
+        m_changes.isLightsCountChanged = true;
+        m_rectangleLightsCount++;
+    }
+
+    void Scene::setRectangleLight(const uint32_t lightIndex, const NOX::RectangleLight &light) {
+        m_lights[lightIndex] = createRectangleLight(light);
+        m_changes.lights.mark(lightIndex, lightIndex + 1u);
     }
 
 } // namespace NOXPT
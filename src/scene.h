@@ -1,6 +1,7 @@
 #pragma once
 
 #include "kernel_types.h"
+#include "model_loader.h"
 
 #include <nox/compute/compute_object.h>
 
@@ -8,24 +9,91 @@
 #include <nox/graphics/light.h>
 #include <nox/graphics/model.h>
 
+#include <nox/maths/bounding_box.h>
+
 #include <nox/renderer/texture.h>
 
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <limits>
+#include <unordered_map>
+
 namespace NOXPT {
 
+    struct Mesh {
+        std::vector<KernelTypes::Triangle> triangles{};
+        std::vector<KernelTypes::Triangle> emissiveTriangles{};
+        size_t trianglesCount{0u};
+        NOX::BoundingBox bounds{};
+    };
+
+    struct Instance {
+        uint32_t meshIndex{};
+        glm::mat4 transform{1.0f};
+        uint32_t lightsOffset{};
+    };
+
+    struct DirtyRange {
+        void mark(size_t first, size_t last) {
+            begin = std::min(begin, first);
+            end = std::max(end, last);
+        }
+
+        bool isEmpty() const { return begin >= end; }
+
+        size_t begin{std::numeric_limits<size_t>::max()};
+        size_t end{0u};
+    };
+
+    struct SceneChanges {
+        bool hasChanges() const { return !materials.isEmpty() || !lights.isEmpty() || isLightsCountChanged || isEmissionChanged || isGeometryChanged || areInstancesChanged; }
+
+        DirtyRange materials{};
+        DirtyRange lights{};
+        bool isLightsCountChanged{false};
+        bool isEmissionChanged{false};
+        bool isGeometryChanged{false};
+        bool areInstancesChanged{false};
+    };
+
     class Scene {
       public:
-        const std::vector<KernelTypes::Triangle> &getTriangles() const { return m_triangles; }
-        std::vector<KernelTypes::Triangle> &getTriangles() { return m_triangles; }
+        const std::vector<Mesh> &getMeshes() const { return m_meshes; }
+        const std::vector<Instance> &getInstances() const { return m_instances; }
         const std::vector<KernelTypes::Light> &getLights() const { return m_lights; }
+        uint32_t getRectangleLightsCount() const { return m_rectangleLightsCount; }
         const std::vector<KernelTypes::Material> &getMaterials() const { return m_materials; }
+        const SceneChanges &getChanges() const { return m_changes; }
+        void clearChanges() { m_changes = {}; }
 
         void addRectangleLight(const NOX::RectangleLight &light);
-        void addModel(const std::shared_ptr<NOX::Model> &model);
+        void setRectangleLight(const uint32_t lightIndex, const NOX::RectangleLight &light);
+        void setMaterial(const uint32_t materialIndex, const KernelTypes::Material &material);
+
+        uint32_t addModel(const std::shared_ptr<NOX::Model> &model, const glm::mat4 &transform = glm::mat4{1.0f});
+        uint32_t addModel(ModelData &&model, const glm::mat4 &transform = glm::mat4{1.0f});
+        uint32_t addInstance(const uint32_t meshIndex, const glm::mat4 &transform);
+        void removeInstance(const uint32_t instanceIndex);
+        void setInstanceTransform(const uint32_t instanceIndex, const glm::mat4 &transform);
+
+        void releaseTriangles();
+        void updateEmissiveTriangles(const uint32_t meshIndex, const KernelTypes::Triangle *triangles, const size_t trianglesCount);
+        void rebuildTriangleLights();
+
+      private:
+        uint32_t addMesh(const std::shared_ptr<NOX::Model> &model);
+        uint32_t addMesh(ModelData &&model);
+        void updateInstanceLights(const Instance &instance);
 
       private:
-        std::vector<KernelTypes::Triangle> m_triangles{};
+        std::vector<Mesh> m_meshes{};
+        std::vector<Instance> m_instances{};
         std::vector<KernelTypes::Light> m_lights{};
         std::vector<KernelTypes::Material> m_materials{};
+        std::unordered_map<const NOX::Model *, uint32_t> m_modelMeshIndices{};
+        uint32_t m_rectangleLightsCount{0u};
+        SceneChanges m_changes{};
     };
 
 } // namespace NOXPT
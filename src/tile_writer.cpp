@@ -0,0 +1,92 @@
+#include "tile_writer.h"
+
+#include <algorithm>
+
+namespace NOXPT {
+
+    TileWriter::TileWriter(const std::string &path, uint32_t width, uint32_t height, size_t maxQueuedTiles) : m_file(path, std::ios::binary | std::ios::out | std::ios::trunc),
+                                                                                                              m_width(width),
+                                                                                                              m_maxQueuedTiles(std::max<size_t>(maxQueuedTiles, 1u)) {
+        if (!m_file.is_open()) {
+            return;
+        }
+
+        const auto header = "PF\n" + std::to_string(width) + " " + std::to_string(height) + "\n-1.0\n";
+        m_file.write(header.data(), static_cast<std::streamsize>(header.size()));
+        m_headerSize = static_cast<std::streamoff>(header.size());
+
+        const auto imageSize = static_cast<std::streamoff>(width) * height * 3 * sizeof(float);
+        m_file.seekp(m_headerSize + imageSize - 1);
+        m_file.put('\0');
+
+        m_thread = std::thread(&TileWriter::run, this);
+    }
+
+    TileWriter::~TileWriter() {
+        finish();
+    }
+
+    void TileWriter::write(Tile &&tile) {
+        if (!m_thread.joinable()) {
+            return;
+        }
+
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_condition.wait(lock, [this] { return m_tiles.size() < m_maxQueuedTiles; });
+        m_tiles.push_back(std::move(tile));
+        m_condition.notify_all();
+    }
+
+    void TileWriter::finish() {
+        if (!m_thread.joinable()) {
+            return;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_isFinished = true;
+        }
+        m_condition.notify_all();
+
+        m_thread.join();
+        m_file.close();
+    }
+
+    void TileWriter::run() {
+        while (true) {
+            Tile tile;
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_condition.wait(lock, [this] { return m_isFinished || !m_tiles.empty(); });
+                if (m_tiles.empty()) {
+                    return;
+                }
+
+                tile = std::move(m_tiles.front());
+                m_tiles.pop_front();
+            }
+            m_condition.notify_all();
+
+            writeTile(tile);
+        }
+    }
+
+    void TileWriter::writeTile(const Tile &tile) {
+        std::vector<float> row(static_cast<size_t>(tile.width) * 3u);
+        for (uint32_t y = 0u; y < tile.height; y++) {
+            for (uint32_t x = 0u; x < tile.width; x++) {
+                const auto &radiance = tile.radiance[x + y * tile.width];
+                const auto samples = std::max(radiance.s[3], 1.0f);
+
+                row[x * 3u + 0u] = radiance.s[0] / samples;
+                row[x * 3u + 1u] = radiance.s[1] / samples;
+                row[x * 3u + 2u] = radiance.s[2] / samples;
+            }
+
+            const auto pixelOffset = static_cast<std::streamoff>(tile.y + y) * m_width + tile.x;
+            m_file.seekp(m_headerSize + pixelOffset * static_cast<std::streamoff>(3 * sizeof(float)));
+            m_file.write(reinterpret_cast<const char *>(row.data()), static_cast<std::streamsize>(row.size() * sizeof(float)));
+        }
+    }
+
+} // namespace NOXPT
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <CL/cl.h>
+
+#include <condition_variable>
+#include <deque>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace NOXPT {
+
+    struct Tile {
+        uint32_t x{};
+        uint32_t y{};
+        uint32_t width{};
+        uint32_t height{};
+        std::vector<cl_float4> radiance{};
+    };
+
+    class TileWriter {
+      public:
+        TileWriter(const std::string &path, uint32_t width, uint32_t height, size_t maxQueuedTiles = 4u);
+        ~TileWriter();
+
+        TileWriter(const TileWriter &) = delete;
+        TileWriter &operator=(const TileWriter &) = delete;
+
+        bool isOpen() const { return m_file.is_open(); }
+
+        void write(Tile &&tile);
+        void finish();
+
+      private:
+        void run();
+        void writeTile(const Tile &tile);
+
+      private:
+        std::ofstream m_file{};
+        uint32_t m_width{};
+        std::streamoff m_headerSize{};
+        size_t m_maxQueuedTiles{};
+
+        std::thread m_thread{};
+        std::mutex m_mutex{};
+        std::condition_variable m_condition{};
+        std::deque<Tile> m_tiles{};
+        bool m_isFinished{false};
+    };
+
+} // namespace NOXPT